@@ -0,0 +1,102 @@
+/* arena.h
+ *
+ * Copyright (C) 2021  Marco van Zwetselaar <io@zwets.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef arena_h_INCLUDED
+#define arena_h_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace gfa {
+
+/* arena - append-only storage for many small objects
+ *
+ * Hands out memory from blocks of at least BLOCK bytes, so that storing
+ * the names and sequences of a million segments takes a few hundred
+ * allocations rather than millions, and they lie together in memory.
+ * Nothing is freed until the arena is, and blocks never move, so what
+ * it hands out stays put when the arena grows or is moved.
+ */
+struct arena {
+
+    static constexpr std::size_t BLOCK = std::size_t(1) << 20;
+
+    arena() { }
+    arena(arena&& a) { *this = std::move(a); }
+
+    arena& operator=(arena&& a) {
+        blocks = std::move(a.blocks);
+        cur = a.cur; left = a.left; used = a.used;
+        a.blocks.clear();
+        a.cur = 0; a.left = 0; a.used = 0;
+        return *this;
+    }
+
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    // n bytes aligned at align (a power of two, at most that of new)
+    void* alloc(std::size_t n, std::size_t align = 1) {
+        std::size_t pad = (align - reinterpret_cast<std::uintptr_t>(cur) % align) % align;
+        if (pad + n > left) {
+            std::size_t sz = n > BLOCK ? n : BLOCK;
+            blocks.emplace_back(new char[sz]);
+            cur = blocks.back().get();
+            left = sz;
+            pad = 0;
+        }
+        char* p = cur + pad;
+        cur += pad + n;
+        left -= pad + n;
+        used += n;
+        return p;
+    }
+
+    // a copy of the n elements at p
+    template <typename T>
+    T* copy(const T* p, std::size_t n) {
+        T* q = static_cast<T*>(alloc(n * sizeof(T), alignof(T)));
+        if (n) std::memcpy(q, p, n * sizeof(T));
+        return q;
+    }
+
+    // a NUL-terminated copy of the n characters at s
+    const char* copy_str(const char* s, std::size_t n) {
+        char* q = static_cast<char*>(alloc(n + 1));
+        std::memcpy(q, s, n);
+        q[n] = '\0';
+        return q;
+    }
+
+    // the bytes handed out, and the number of blocks they took
+    inline std::size_t size() const { return used; }
+    inline std::size_t n_blocks() const { return blocks.size(); }
+
+    private:
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char* cur = 0;
+        std::size_t left = 0;
+        std::size_t used = 0;
+};
+
+} // namespace gfa
+
+#endif // arena_h_INCLUDED
+       // vim: sts=4:sw=4:ai:si:et
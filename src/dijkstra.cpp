@@ -18,7 +18,10 @@
 
 #include "dijkstra.h"
 
+#include <algorithm>
+#include <memory>
 #include "paths.h"
+#include "parallel.h"
 #include "utils.h"
 
 namespace gfa {
@@ -27,205 +30,491 @@ using gene_paths::raise_error;
 using gene_paths::verbose_emit;
 
 void
-dijkstra::restart(const arc* start)
+dijkstra::restart(const target* from, const target* const* tos, std::size_t n_tos)
 {
     // clear the paths, dnodes, and visitables
 
     ps.clear();
-    ds.clear();
-    vs.clear();
     found_pix = 0;
     found_len = 0;
+    found_pixs.clear();
 
-    // set up ds to have all w_lw (destinations), initialising them
-    // with infinite length and a null path reference.
+    // overlay the virtual arcs of the targets, and make their virtual
+    // segments available to ps, which writes the paths that cross them
 
-    std::pair<std::uint64_t, dnode> val = { 0, { std::size_t(-1), 0 } };
+    ovl.clear();
+    ends.clear();
+    const arc* as[2];
 
-    for (auto it = g.arcs.cbegin(); it != g.arcs.cend(); ++it)
-    {
-        val.first = it->w_lw;
-        ds.insert(val);
+    if (from)
+        ovl.insert(ovl.end(), as, as + from->overlay_arcs(as));
+
+    // an END target on the same section as the START target gets copies
+    // of its arcs moved onto the START target segment, so that both share
+    // it and the path can go from START to END within it
+
+    shared.clear();
+    shared.reserve(2 * n_tos);  // so the pointers to it in ovl stay valid
+
+    for (std::size_t i = 0; i < n_tos; ++i) {
+        const std::size_t n = tos[i]->overlay_arcs(as);
+
+        if (from && tos[i]->same_seg(*from)) {
+            const std::uint64_t t_seg = tos[i]->seg_ix(), f_seg = from->seg_ix();
+            auto move = [t_seg, f_seg](std::uint64_t v_lv) {
+                std::uint64_t v = graph::vlv_v(v_lv);
+                return graph::vtx_seg(v) != t_seg ? v_lv
+                    : graph::v_lv(graph::seg_vtx(f_seg, graph::is_neg(v)), graph::vlv_lv(v_lv));
+            };
+            for (std::size_t k = 0; k < n; ++k) {
+                shared.push_back({ move(as[k]->v_lv), move(as[k]->w_lw) });
+                ovl.push_back(&shared.back());
+            }
+        }
+        else
+            ovl.insert(ovl.end(), as, as + n);
+
+        ends.push_back(g.dsts.size() + ovl.size() - 1);
     }
 
-    // if we have a start arc, add it to visitables
-    if (start) {
+    ovl_ix.clear();
+    for (std::uint32_t k = 0; k < ovl.size(); ++k)
+        ovl_ix.emplace_back(ovl[k]->v_lv, k);
+    std::sort(ovl_ix.begin(), ovl_ix.end());
+
+    // the terminal, then the START, then the END target segments
+
+    const std::size_t S = g.segs.size();
+
+    ps.xsegs.assign(2 + std::max(n_tos, std::size_t(1)), 0);
+    ps.xsegs[0] = from ? from->find_seg(S) : n_tos ? tos[0]->find_seg(S) : 0;
+    ps.xsegs[1] = from ? from->find_seg(S + 1) : 0;
+
+    for (std::size_t i = 0; i < n_tos; ++i)
+        ps.xsegs[2 + i] = tos[i]->find_seg(S + 2 + i);
+
+    // reset the dnodes that the previous search touched to infinite length
+    // and a null path reference, then size ds to have all destinations;
+    // this is by slot, so stays correct when the overlay has changed
+
+    const std::size_t n_dsts = g.dsts.size() + ovl.size();
+    const dnode inf = { std::size_t(-1), 0 };
+
+    for (std::uint32_t d_ix : touched)
+        if (d_ix < ds.size())
+            ds[d_ix] = inf;
+
+    ds.resize(n_dsts, inf);
+    vs.reset(n_dsts, touched);
+    touched.clear();
+
+    // if we have a start target, add its terminal arc to visitables
+    if (from) {
 
         // add start arc to path_arcs in ps, it will have p_ix 1
-        std::size_t p_ix = ps.extend(0, start);
+        std::size_t p_ix = ps.extend(0, ovl.front());
 
-        // look up the start arc destination in ds
-        dmap_t::iterator d_it = ds.find(start->w_lw);
-        if (d_it == ds.end())
-            raise_error("start arc not found in graph");
+        // its destination slot is the first virtual slot
+        std::uint32_t d_ix = g.dsts.size();
 
         // update its dnode to have len 0 and p_ix 1
-        d_it->second = { 0, p_ix };
+        ds[d_ix] = { 0, p_ix };
+        touched.push_back(d_ix);
 
         // add a visitable for the start arc
-        vs.insert(d_it);
+        vs.push_or_update(d_ix);
     }
+
+    // reset the backward search in the same way, meet_paths seeds it
+
+    for (std::uint32_t d_ix : btouched)
+        if (d_ix < bs.size())
+            bs[d_ix] = inf;
+
+    bs.resize(n_dsts, inf);
+    bvs.reset(n_dsts, btouched);
+    btouched.clear();
+
+    meet_end = 0;
+    meet_len = std::size_t(-1);
+    meet_slot = dheap::NONE;
+
+    skip_twins = false;
+}
+
+
+constexpr std::uint32_t dijkstra::dheap::NONE;
+constexpr std::uint64_t dijkstra::dnode::VISITED;
+
+void
+dijkstra::dheap::reset(std::size_t n, const std::vector<std::uint32_t>& slots)
+{
+    for (std::uint32_t slot : slots)
+        if (slot < pos.size())
+            pos[slot] = NONE;
+
+    heap.clear();
+    pos.resize(n, NONE);
+}
+
+void
+dijkstra::dheap::push_or_update(std::uint32_t slot)
+{
+    if (pos[slot] == NONE) {
+        pos[slot] = heap.size();
+        heap.push_back(slot);
+    }
+
+    sift_up(pos[slot]);
+}
+
+std::uint32_t
+dijkstra::dheap::pop()
+{
+    std::uint32_t top = heap.front();
+    pos[top] = NONE;
+
+    std::uint32_t last = heap.back();
+    heap.pop_back();
+
+    if (!heap.empty()) {
+        heap[0] = last;
+        pos[last] = 0;
+        sift_down(0);
+    }
+
+    return top;
+}
+
+void
+dijkstra::dheap::sift_up(std::size_t i)
+{
+    std::uint32_t slot = heap[i];
+
+    while (i) {
+        std::size_t p = (i - 1) >> 1;
+        if (!less(slot, heap[p]))
+            break;
+        heap[i] = heap[p];
+        pos[heap[i]] = i;
+        i = p;
+    }
+
+    heap[i] = slot;
+    pos[slot] = i;
+}
+
+void
+dijkstra::dheap::sift_down(std::size_t i)
+{
+    std::uint32_t slot = heap[i];
+    std::size_t n = heap.size();
+
+    for (;;) {
+        std::size_t c = (i << 1) + 1;
+        if (c >= n)
+            break;
+        if (c + 1 < n && less(heap[c+1], heap[c]))
+            ++c;
+        if (!less(heap[c], slot))
+            break;
+        heap[i] = heap[c];
+        pos[heap[i]] = i;
+        i = c;
+    }
+
+    heap[i] = slot;
+    pos[slot] = i;
 }
 
 
 dijkstra::dnode&
 dijkstra::pop_visit()
 {
-    dmap_t::iterator top = *vs.begin();
-    dnode& d = top->second;
+    std::uint32_t top = vs.pop();
+    dnode& d = ds[top];
 #ifndef NDEBUG
     if (d.is_visited())
         raise_error("programmer error: dijkstra: visitable dnode already visited");
     if (!d.p_ref)
         raise_error("programmer error: dijkstra: visitable dnode without a p_ref");
-    if (top->first != ps.path_arcs.at(d.p_ref).p_arc->w_lw)
+    if (dst_at(top) != ps.path_arcs.at(d.p_ref).p_arc->w_lw)
         raise_error("programmer error: dijkstra: visitable dnode indexed at wrong w_lw");
 #endif
-    vs.erase(top);
     return d;
 }
 
 
 void
-dijkstra::furthest_path(const arc* start)
+dijkstra::furthest_path(const target& from)
 {
         // find all paths from start
 
-    find_paths(start);
+    find_paths(from);
 
-        // locate the longest using the ds array
+        // locate the longest among the dnodes the search touched, taking
+        // the lowest slot on ties, as a scan over all of ds would
 
     std::size_t max_len = 0;
-    dmap_t::const_iterator max_it = ds.cbegin();
+    std::uint32_t max_ix = 0;
 
-    for (dmap_t::const_iterator it = ds.cbegin(); it != ds.cend(); ++it) {
-        if (it->second.is_visited() && it->second.len > max_len) {
-            max_len = it->second.len;
-            max_it = it;
+    for (std::uint32_t i : touched) {
+        if (ds[i].is_visited() && (ds[i].len > max_len || (ds[i].len == max_len && i < max_ix))) {
+            max_len = ds[i].len;
+            max_ix = i;
         }
     }
         // store its path_ix and length in the found fields
 
-    found_pix = max_it->second.p_ix();
+    found_pix = ds.empty() ? 0 : ds[max_ix].p_ix();
     found_len = max_len;
     verbose_emit("found furthest path %lu with length %lu", found_pix, found_len);
 }
 
 
-/*
+// the target ref of the whole contig on vertex v
+static std::string
+vtx_ref(const graph& g, std::uint64_t v)
+{
+    return g.segs[graph::vtx_seg(v)].name.str() + (graph::is_neg(v) ? '-' : '+');
+}
 
 void
-dijkstra::furthest_path()
+dijkstra::furthest_path(target& from, std::size_t n_threads)
 {
-    const arc* max_arc = &*g.arcs.cbegin();
-    size_t max_len = 0;
+    const std::size_t n = g.segs.size() << 1;
+
+        // each worker searches from its share of the contigs, with a target
+        // and dijkstra of its own on the shared graph, and keeps the longest
+        // length it found with the lowest vertex that has it
+
+    struct worker {
+        target from;
+        dijkstra d;
+        std::size_t max_len = 0;
+        std::size_t max_vtx = std::size_t(-1);
+        worker(const graph& g, std::size_t max_dist) : from(g), d(g) { d.max_dist = max_dist; }
+    };
+
+    if (!n_threads) n_threads = 1;
+    std::vector<std::unique_ptr<worker>> ws(n_threads);
+
+    gene_paths::parallel_for(n_threads, n, [&](std::size_t w, std::size_t v) {
+
+        if (!ws[w])
+            ws[w].reset(new worker(g, max_dist));
+
+        worker& wk = *ws[w];
+        std::size_t len = g.segs[graph::vtx_seg(v)].len;
+
+            // a contig that no arc leaves at its end is a dead end, so the
+            // furthest path from it is the contig itself: skip the search
+
+        auto as = g.arcs_from_v_lv(graph::v_lv(v, len));
+        if (as.first != as.second || len > max_dist) {
+            wk.from.set(vtx_ref(g, v), target::START);
+            wk.d.furthest_path(wk.from);
+            len = wk.d.found_len;
+        }
+
+        if (len > wk.max_len || (len == wk.max_len && v < wk.max_vtx)) {
+            wk.max_len = len;
+            wk.max_vtx = v;
+        }
+    });
 
-    for (auto ait = g.arcs.cbegin(); ait != g.arcs.cend(); ++ait) {
+        // pick the longest over the workers, and search it again in this
+        // dijkstra so that its path is in ps
 
-        furthest_path(&*ait);
+    std::size_t max_len = 0;
+    std::size_t max_vtx = std::size_t(-1);
 
-        if (found_len > max_len) { 
-            max_len = found_len;
-            max_arc = &*ait;
+    for (const auto& wk : ws)
+        if (wk && (wk->max_len > max_len || (wk->max_len == max_len && wk->max_vtx < max_vtx))) {
+            max_len = wk->max_len;
+            max_vtx = wk->max_vtx;
         }
+
+    if (max_vtx == std::size_t(-1)) {
+        restart();
+        return;
     }
 
-    furthest_path(max_arc);
-}
-*/
+    verbose_emit("furthest path starts at %s", vtx_ref(g, max_vtx).c_str());
 
+    from.set(vtx_ref(g, max_vtx), target::START);
+    furthest_path(from);
+}
 
-bool
-dijkstra::find_paths(const arc* start, const arc* end)
-{
-    restart(start);
 
-    while (!found_pix && !vs.empty()) {
 
-        // pick the next node to visit
-        dnode& vn = pop_visit();    // has .len and .p_ref
+dijkstra::dnode&
+dijkstra::visit_next()
+{
+    // pick the next node to visit
+    dnode& vn = pop_visit();    // has .len and .p_ref
 
-        // retrieve the path index, path arc and len to arrive at vn
-        std::size_t cur_pix = vn.p_ref;
-        std::size_t cur_len = vn.len;
-        const arc*  cur_arc = ps.at(cur_pix).p_arc;
+    // retrieve the path index, path arc and len to arrive at vn
+    std::size_t cur_pix = vn.p_ref;
+    std::size_t cur_len = vn.len;
 #ifndef NDEBUG
-        verbose_emit("start visit of p_ref %lu at %lu", cur_pix, cur_len);
+    verbose_emit("start visit of p_ref %lu at %lu", cur_pix, cur_len);
 #endif
-        // the dest (w_lw) of that arc is the new start (v_lv)
-        std::uint64_t v_lv = cur_arc->w_lw;
+    relax_from(cur_pix, cur_len);
 
-        // get all arcs leaving from vn's vertex at lv or later
-        const auto iters = g.arcs_from_v_lv(v_lv);
+    // the vn is now visited and the shortest path to its arc
+    vn.mark_visited();
 
-        // look at the arcs to each tentative destination in turn
-        for (auto a_it = iters.first; a_it != iters.second; ++a_it) {
+    return vn;
+}
 
-            // ignore any arc that would take us right back
-            if (a_it->w_lw == cur_arc->v_lv)
-                continue;
 
-            // Note how we iterate over outbound arcs, where added length
-            // lies on vn's contig, and then a (zero-length) jump is made:
-            //
-            //            w: --1------2---o---->
-            //                 |     /
-            //    v: ---x======1----2------>
-            //
-            // We are at vn=x (the w_lw of vn's arc) and iterate the arcs
-            // downstream on v (v1-w1 and v2-w2).  We compute the length of
-            // the '===' segments as the added distance.
-
-            // compute distance to the departing arc
-            std::uint64_t add_len = a_it->v_lv - v_lv;
-
-            // locate the dnode for the tentative destination, which will
-            // have the shortest path found to it so far (INF if not seen)
-            const dmap_t::iterator d_it = ds.find(a_it->w_lw);
-            dnode& dn = d_it->second;
-
-            // if the new path is shorter, update the tentative dest
-            if (cur_len + add_len < dn.len) {
+void
+dijkstra::relax_from(std::size_t cur_pix, std::size_t cur_len, const std::vector<const arc*>* bans)
+{
+    const arc* cur_arc = ps.at(cur_pix).p_arc;
+
+    // the dest (w_lw) of that arc is the new start (v_lv)
+    std::uint64_t v_lv = cur_arc->w_lw;
+
+    // get all arcs leaving from vn's vertex at lv or later
+    const auto iters = g.arcs_from_v_lv(v_lv);
+
+    // look at the arcs to each tentative destination in turn
+    for (auto a_it = iters.first; a_it != iters.second; ++a_it)
+        if (!bans || std::find(bans->cbegin(), bans->cend(), &*a_it) == bans->cend())
+            if (!skip_twins || !is_twin(v_lv, *a_it))
+                relax(cur_pix, cur_len, cur_arc, &*a_it, g.arc_dst(&*a_it));
+
+    // and likewise at the virtual arcs leaving from there
+    auto o_it = std::lower_bound(ovl_ix.cbegin(), ovl_ix.cend(), std::make_pair(v_lv, std::uint32_t(0)));
+
+    for (; o_it != ovl_ix.cend() && graph::vlv_v(o_it->first) == graph::vlv_v(v_lv); ++o_it) {
+        const arc* a = ovl[o_it->second];
+        if (!bans || std::find(bans->cbegin(), bans->cend(), a) == bans->cend())
+            relax(cur_pix, cur_len, cur_arc, a, g.dsts.size() + o_it->second);
+    }
+}
+
+
+void
+dijkstra::relax(std::size_t cur_pix, std::size_t cur_len, const arc* cur_arc, const arc* a, std::uint32_t d_ix)
+{
+    // ignore any arc that would take us right back
+    if (a->w_lw == cur_arc->v_lv)
+        return;
+
+    // Note how we iterate over outbound arcs, where added length
+    // lies on vn's contig, and then a (zero-length) jump is made:
+    //
+    //            w: --1------2---o---->
+    //                 |     /
+    //    v: ---x======1----2------>
+    //
+    // We are at vn=x (the w_lw of vn's arc) and iterate the arcs
+    // downstream on v (v1-w1 and v2-w2).  We compute the length of
+    // the '===' segments as the added distance.
+
+    // compute distance to the departing arc
+    std::uint64_t add_len = a->v_lv - cur_arc->w_lw;
+
+    // locate the dnode for the tentative destination, which will
+    // have the shortest path found to it so far (INF if not seen)
+    dnode& dn = ds[d_ix];
+
+    // if the new path is shorter, update the tentative dest
+    if (cur_len + add_len < dn.len) {
 #ifndef NDEBUG
-                if (dn.is_visited())
-                    raise_error("programmer error: dijkstra: visited node with shorter path found");
+        if (dn.is_visited())
+            raise_error("programmer error: dijkstra: visited node with shorter path found");
 #endif
-                // if we haven't seen this destination yet
-                if (!dn.p_ref) {
-                    // add a path_arc from us to it to ps
-                    dn.p_ref = ps.extend(cur_pix, &*a_it);
+        // if we haven't seen this destination yet
+        if (!dn.p_ref) {
+            // add a path_arc from us to it to ps
+            dn.p_ref = ps.extend(cur_pix, a);
+            touched.push_back(d_ix);
 #ifndef NDEBUG
-                    verbose_emit("- extended with new p_ref %lu (+%lu)", dn.p_ref, add_len);
+            verbose_emit("- extended with new p_ref %lu (+%lu)", dn.p_ref, add_len);
 #endif
-                }
-                else {
-                    // remove old record from the visitables list
-                    vs.erase(d_it);
-                    // repoint its pre-path to the vn, and set new arc
-                    // note: it can't be the pre_ix of anything yet
-                    path_arc& d_pa = ps.at(dn.p_ref);
-                    d_pa.pre_ix = cur_pix;
-                    d_pa.p_arc = &*a_it;
+        }
+        else {
+            // repoint its pre-path to the vn, and set new arc
+            // note: it can't be the pre_ix of anything yet
+            ps.repoint(dn.p_ref, cur_pix, a);
+#ifndef NDEBUG
+            verbose_emit("- updated existing p_ref %lu (-%lu)", dn.p_ref, dn.len - (cur_len + add_len));
+#endif
+        }
+
+        // update the dnode with the new shortest length
+        dn.len = cur_len + add_len;
+
+        // and add it to, or move it up in, the visitables
+        vs.push_or_update(d_ix);
+
+        // if the backward search has been here, we may have met
+        if (meet_end && bs[d_ix].len != std::size_t(-1))
+            meet(d_ix);
+    }
+}
+
+
+std::size_t
+dijkstra::shortest_paths(const target& from, const std::vector<const target*>& tos, std::size_t n)
+{
+    restart(&from, tos);
+
+    // search until n of the END targets have been visited, as then their
+    // shortest paths are known, or until there is nothing left to visit
+
+    n = std::min(n, ends.size());
+
+    while (found_pixs.size() < n && !vs.empty() && ds[vs.top()].len < bound()) {
+
+        const dnode& vn = visit_next();
+        const std::uint32_t slot = &vn - ds.data();
+
+        if (slot >= g.dsts.size() && std::binary_search(ends.cbegin(), ends.cend(), slot)) {
+            found_pixs.push_back(vn.p_ix());
 #ifndef NDEBUG
-                    verbose_emit("- updated existing p_ref %lu (-%lu)", dn.p_ref, dn.len - (cur_len + add_len));
+            verbose_emit("- reached end target at slot %u with length %lu", slot, vn.len);
 #endif
-                }
+        }
+    }
 
-                // update the dnode with the new shortest length
-                dn.len = cur_len + add_len;
+    if (!found_pixs.empty()) {
+        found_pix = found_pixs.front();
+        found_len = ps.length(ps.at(found_pix));
+    }
 
-                // and (re)add it to the visitables
-                vs.insert(d_it);
+    verbose_emit("reached %lu of %lu end targets, exploring %lu (potential) paths", found_pixs.size(), ends.size(), ps.path_arcs.size());
 
-            } // end if shorter path
+    return found_pixs.size();
+}
 
-        } // end iterate over tentatives
 
-        // the vn is now visited and the shortest path to its arc
-        vn.mark_visited();
+std::size_t
+dijkstra::path_to(std::size_t i) const
+{
+    const dnode& d = ds[ends.at(i)];
+    return d.is_visited() ? d.p_ix() : 0;
+}
+
+
+bool
+dijkstra::find_paths(const target& from, const target* to)
+{
+    restart(&from, to);
+
+    const arc* end = to ? ovl.back() : 0;     // its terminal arc, or a copy
+
+    while (!found_pix && !vs.empty() && ds[vs.top()].len < bound()) {
+
+        // visit the next node, relaxing its outbound arcs
+        dnode& vn = visit_next();
 
         // check if we are done, i.e. the vn took the end arc
-        if (end && cur_arc == end) {
+        if (end && ps.at(vn.p_ix()).p_arc == end) {
             found_pix = vn.p_ix();
             found_len = vn.len;
             verbose_emit("shortest path found with length %lu (index %lu)", found_len, found_pix);
@@ -240,6 +529,540 @@ dijkstra::find_paths(const arc* start, const arc* end)
 }
 
 
+void
+dijkstra::visit_back()
+{
+    // pick the next node to visit backward, that is the slot nearest to
+    // the end, and the arc by which it leaves (null for the end itself)
+
+    std::uint32_t y_ix = bvs.pop();
+    dnode& yn = bs[y_ix];
+    const arc* nxt_arc = yn.p_ix() ? arc_at(yn.p_ix() - 1) : 0;
+#ifndef NDEBUG
+    if (yn.is_visited())
+        raise_error("programmer error: dijkstra: backward visitable already visited");
+#endif
+    // Note how this mirrors the forward search: arriving at y over arc a,
+    // the path to the end goes downstream on y's vertex to leave over
+    // nxt_arc.  Going back over a we are at a.v_lv, and any destination x
+    // upstream of that on a's vertex can reach it:
+    //
+    //    v: ---x0----x1====a---->
+    //                      |
+    //            w:   -----y=====n--->
+    //
+    // Rather than relaxing all those x, we relax only the one nearest
+    // upstream (x1, see g.arc_pres), and when x1 is visited it relaxes
+    // x0 (its predecessor slot on the same vertex), and so on.  The few
+    // virtual destinations are not in that chain, so are relaxed directly.
+
+    if (y_ix < g.dsts.size()) {
+
+        if (y_ix && g.dsts[y_ix-1]>>32 == g.dsts[y_ix]>>32)
+            relax_back(y_ix - 1, yn.len + (g.dsts[y_ix] - g.dsts[y_ix-1]), yn.p_ref);
+
+        const auto iters = g.arcs_into_dst(y_ix);
+
+        for (auto r_it = iters.first; r_it != iters.second; ++r_it) {
+
+            const arc& a = g.arcs[*r_it];
+
+            // ignore any arc that would be the forward search's u-turn
+            if (a.v_lv == nxt_arc->w_lw)
+                continue;
+
+            relax_upstream(a, g.arc_pres[*r_it], yn.len, *r_it + 1);
+        }
+    }
+    else { // a virtual destination has just its virtual arc coming in
+
+        const std::size_t k = y_ix - g.dsts.size();
+        const arc& a = *ovl[k];
+
+        // the end destination can only be arrived at over the end arc,
+        // and ignore any arc that would be the forward search's u-turn
+        if (nxt_arc ? a.v_lv != nxt_arc->w_lw : &a == meet_end) {
+
+            auto it = std::upper_bound(g.dsts.cbegin(), g.dsts.cend(), a.v_lv);
+            std::uint32_t pre = it != g.dsts.cbegin() && graph::vlv_v(*(it-1)) == a.v()
+                ? (it - 1) - g.dsts.cbegin() : graph::NO_DST;
+
+            relax_upstream(a, pre, yn.len, g.arcs.size() + k + 1);
+        }
+    }
+
+    yn.mark_visited();
+}
+
+
+void
+dijkstra::relax_upstream(const arc& a, std::uint32_t pre, std::size_t len, std::uint64_t ref)
+{
+    if (pre != graph::NO_DST)
+        relax_back(pre, len + (a.v_lv - g.dsts[pre]), ref);
+
+    for (std::size_t k = 0; k < ovl.size(); ++k)
+        if (ovl[k]->w() == a.v() && ovl[k]->w_lw <= a.v_lv)
+            relax_back(g.dsts.size() + k, len + (a.v_lv - ovl[k]->w_lw), ref);
+}
+
+
+void
+dijkstra::relax_back(std::uint32_t slot, std::size_t len, std::uint64_t ref)
+{
+    dnode& xn = bs[slot];
+
+    if (len < xn.len) {
+#ifndef NDEBUG
+        if (xn.is_visited())
+            raise_error("programmer error: dijkstra: backward visited node with shorter path found");
+#endif
+        if (xn.len == std::size_t(-1))
+            btouched.push_back(slot);
+
+        xn = { len, ref };
+        bvs.push_or_update(slot);
+
+        // if the forward search has been here, we may have met
+        if (ds[slot].p_ref)
+            meet(slot);
+    }
+}
+
+
+void
+dijkstra::meet(std::uint32_t slot)
+{
+    const arc* fwd_arc = ps.at(ds[slot].p_ix()).p_arc;
+    const dnode& bn = bs[slot];
+
+    // the paths join only if the backward one does not go right back
+    // where the forward came from, and the end is only reached by its arc
+
+    if (bn.p_ix() ? arc_at(bn.p_ix() - 1)->w_lw == fwd_arc->v_lv : fwd_arc != meet_end)
+        return;
+
+    if (ds[slot].len + bn.len < meet_len) {
+        meet_len = ds[slot].len + bn.len;
+        meet_slot = slot;
+#ifndef NDEBUG
+        verbose_emit("- searches meet at slot %u with length %lu", slot, meet_len);
+#endif
+    }
+}
+
+
+bool
+dijkstra::meet_paths(const target& from, const target& to)
+{
+    restart(&from, &to);
+
+    // seed the backward search with the end arc, which is the last virtual arc
+
+    const std::uint32_t end_ix = g.dsts.size() + ovl.size() - 1;
+
+    meet_end = ovl.back();
+    bs[end_ix] = { 0, 0 };
+    btouched.push_back(end_ix);
+    bvs.push_or_update(end_ix);
+
+    // alternately extend the search with fewer visitables, until the
+    // nearest forward and backward visitables together are no shorter
+    // than the shortest meeting: then no shorter path can still exist;
+    // starting as if we met at the bound, no longer path will be found
+
+    meet_len = bound();
+
+    while (!vs.empty() && !bvs.empty()) {
+
+        if (ds[vs.top()].len + bs[bvs.top()].len >= meet_len)
+            break;
+
+        if (vs.size() <= bvs.size())
+            visit_next();
+        else
+            visit_back();
+    }
+
+    // extend the forward path from the meeting slot with the arcs of the
+    // backward path, so the result is in ps just as if found forward
+
+    if (meet_slot != dheap::NONE) {
+
+        std::size_t p_ix = ds[meet_slot].p_ix();
+        std::uint64_t b_ref = bs[meet_slot].p_ix();
+
+        while (b_ref) {
+            const std::size_t a_ix = b_ref - 1;
+            p_ix = ps.extend(p_ix, arc_at(a_ix));
+            b_ref = bs[a_ix < g.arcs.size() ? g.arc_dsts[a_ix] : g.dsts.size() + a_ix - g.arcs.size()].p_ix();
+        }
+
+        found_pix = p_ix;
+        found_len = meet_len;
+#ifndef NDEBUG
+        if (ps.length(ps.at(found_pix)) != found_len)
+            raise_error("programmer error: dijkstra: joined path length differs from meeting length");
+#endif
+        verbose_emit("shortest path found with length %lu (index %lu)", found_len, found_pix);
+    }
+
+    verbose_emit("done exploring %lu forward and %lu backward (potential) paths", ps.path_arcs.size(), btouched.size());
+
+    return found_pix;
+}
+
+
+std::uint32_t
+dijkstra::slot_of(const arc* a) const
+{
+    const std::size_t a_ix = a - g.arcs.data();
+    return a_ix < g.arcs.size() ? g.arc_dsts[a_ix]
+        : g.dsts.size() + (std::find(ovl.cbegin(), ovl.cend(), a) - ovl.cbegin());
+}
+
+
+bool
+dijkstra::is_twin(std::uint64_t v_lv, const arc& a) const
+{
+    // a lands at lw on w, its twin would leave lw earlier and land at 0,
+    // which from v_lv is possible if that is not upstream of v_lv
+
+    const std::uint64_t lw = a.lw();
+
+    if (!lw || a.lv() < lw || v_lv + lw > a.v_lv)
+        return false;
+
+    const auto iters = g.arcs_from_v_lv(a.v_lv - lw);
+
+    for (auto it = iters.first; it != iters.second && it->v_lv == a.v_lv - lw; ++it)
+        if (it->w_lw == a.w_lw - lw)
+            return true;
+
+    return false;
+}
+
+
+std::vector<const arc*>
+dijkstra::arcs_of(std::size_t p_ix) const
+{
+    std::vector<const arc*> as;
+
+    for (; p_ix; p_ix = ps.at(p_ix).pre_ix)
+        as.push_back(ps.at(p_ix).p_arc);
+
+    std::reverse(as.begin(), as.end());
+    return as;
+}
+
+
+void
+dijkstra::find_to_end(const target& from, const target& to)
+{
+    // run the backward search of meet_paths until it has been everywhere
+
+    restart(&from, &to);
+
+    const std::uint32_t end_ix = g.dsts.size() + ovl.size() - 1;
+
+    meet_end = ovl.back();
+    bs[end_ix] = { 0, 0 };
+    btouched.push_back(end_ix);
+    bvs.push_or_update(end_ix);
+
+    while (!bvs.empty())
+        visit_back();
+
+    // copy out its lengths, resetting only those set the previous time
+
+    for (std::uint32_t slot : to_end_touched)
+        if (slot < to_end.size())
+            to_end[slot] = std::size_t(-1);
+
+    to_end.resize(bs.size(), std::size_t(-1));
+
+    for (std::uint32_t slot : btouched)
+        to_end[slot] = bs[slot].len;
+
+    to_end_touched = btouched;
+}
+
+
+bool
+dijkstra::spur_path(const target& from, const target& to, const std::vector<const arc*>& root,
+        std::size_t spur_ix, const std::vector<const arc*>& bans, std::size_t limit)
+{
+    restart(&from, &to);
+
+    // restart seeded the start arc as path 1, we take it from there and
+    // lay down the root, marking its slots as visited at length 0, so that
+    // no path can be relaxed into them
+
+    vs.pop();
+    skip_twins = true;
+
+    std::size_t p_ix = 1;
+    ds[g.dsts.size()] = { 0, dnode::VISITED };
+
+    for (std::size_t i = 1; i <= spur_ix; ++i) {
+        p_ix = ps.extend(p_ix, root[i]);
+        std::uint32_t slot = slot_of(root[i]);
+        ds[slot] = { 0, dnode::VISITED };
+        touched.push_back(slot);
+    }
+
+    // no need to search if even the shortest way on from the spur is too long
+
+    const std::size_t spur_len = ps.length(ps.at(p_ix));
+    if (spur_len >= limit || to_end[slot_of(root[spur_ix])] >= limit - spur_len)
+        return false;
+
+    relax_from(p_ix, spur_len, &bans);
+
+    // search on as find_paths does, but stop when the nearest is too long
+    // to make it, and do not visit slots that are too far from the end
+
+    const arc* end = ovl.back();
+
+    while (!vs.empty()) {
+
+        const std::uint32_t top = vs.top();
+        const std::size_t len = ds[top].len;
+
+        if (len >= limit)
+            break;
+
+        if (to_end[top] >= limit - len) {
+            ds[vs.pop()].mark_visited();
+            continue;
+        }
+
+        dnode& vn = visit_next();
+
+        if (ps.at(vn.p_ix()).p_arc == end) {
+            found_pix = vn.p_ix();
+            found_len = vn.len;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+std::size_t
+dijkstra::top_paths(const target& from, const target& to, std::size_t k)
+{
+    if (!k) {
+        restart();
+        return 0;
+    }
+
+        // the first top is the shortest path, but found without twins,
+        // so all paths have them in the same (earliest) place
+
+    find_to_end(from, to);
+
+    const std::vector<const arc*> start(1, ovl.front());
+    std::vector<const arc*> bans;
+
+    if (!spur_path(from, to, start, 0, bans, bound()))
+        return 0;
+
+        // the paths in the top so far and the candidates for the next,
+        // as their arcs, because ps is cleared for each search
+
+    struct path { std::size_t len; std::vector<const arc*> arcs; };
+
+    std::vector<path> tops(1, { found_len, arcs_of(found_pix) });
+    std::vector<path> cands;
+    std::vector<std::size_t> lens;
+
+    while (tops.size() < k) {
+
+        const std::size_t prev = tops.size() - 1;
+
+            // deviate from the previous top path at each of its slots
+
+        for (std::size_t i = 0; i + 1 < tops[prev].arcs.size(); ++i) {
+
+            const std::vector<const arc*>& root = tops[prev].arcs;
+
+                // a path that is not shorter than the n-th candidate, where
+                // n is the number of tops still to go, can't make the top
+
+            std::size_t limit = bound();
+            const std::size_t n = k - tops.size();
+
+            if (cands.size() >= n) {
+                lens.clear();
+                for (const path& c : cands)
+                    lens.push_back(c.len);
+                std::nth_element(lens.begin(), lens.begin() + (n-1), lens.end());
+                limit = std::min(limit, lens[n-1]);
+            }
+
+                // ban the arcs by which the tops that share the root leave it
+
+            bans.clear();
+            for (const path& t : tops)
+                if (t.arcs.size() > i + 1 && std::equal(root.cbegin(), root.cbegin() + i + 1, t.arcs.cbegin()))
+                    bans.push_back(t.arcs[i+1]);
+
+            if (spur_path(from, to, root, i, bans, limit)) {
+
+                path c = { found_len, arcs_of(found_pix) };
+
+                if (std::none_of(cands.cbegin(), cands.cend(), [&c](const path& p) { return p.arcs == c.arcs; }))
+                    cands.push_back(std::move(c));
+            }
+        }
+
+            // the shortest candidate (the first on ties) is the next top
+
+        if (cands.empty())
+            break;
+
+        auto it = std::min_element(cands.begin(), cands.end(), [](const path& p1, const path& p2) { return p1.len < p2.len; });
+        tops.push_back(std::move(*it));
+        cands.erase(it);
+    }
+
+        // put the tops in ps, where each shares its longest common prefix with
+        // the tops before it, so they are written like any other path
+
+    restart(&from, &to);
+
+    std::vector<std::vector<std::size_t>> pixs;
+
+    for (const path& t : tops) {
+
+        std::vector<std::size_t> ixs(1, 1);     // all have the start arc at 1
+
+        for (std::size_t j = 0; j < pixs.size(); ++j) {
+            auto m = std::mismatch(t.arcs.cbegin(), t.arcs.cend(), tops[j].arcs.cbegin(), tops[j].arcs.cend());
+            std::size_t n = m.first - t.arcs.cbegin();
+            if (n > ixs.size())
+                ixs.assign(pixs[j].cbegin(), pixs[j].cbegin() + n);
+        }
+
+        for (std::size_t i = ixs.size(); i < t.arcs.size(); ++i)
+            ixs.push_back(ps.extend(ixs.back(), t.arcs[i]));
+
+        found_pixs.push_back(ixs.back());
+        pixs.push_back(std::move(ixs));
+    }
+
+    found_pix = found_pixs.front();
+    found_len = tops.front().len;
+    verbose_emit("found %lu shortest paths, lengths %lu to %lu", tops.size(), tops.front().len, tops.back().len);
+
+    return found_pixs.size();
+}
+
+
+std::size_t
+dijkstra::all_paths(const target& from, const target& to, std::size_t max_len,
+        const std::function<void(std::size_t)>& emit)
+{
+    max_len = std::min(max_len, max_dist);
+    find_to_end(from, to);
+
+        // we do a depth first search from the start arc that restart seeded
+        // as path 1, so ps is the stack of path arcs; the slots on the path
+        // are marked visited, so that no path visits a slot twice, and twins
+        // are skipped, as with top_paths
+
+    restart(&from, &to);
+    vs.pop();
+    skip_twins = true;
+
+    const arc* end = ovl.back();
+    std::size_t n_found = 0;
+
+        // a frame has the path so far and the arcs it has yet to try
+
+    struct frame {
+        std::size_t p_ix;
+        std::uint32_t slot;
+        std::vector<arc>::const_iterator it, it_end;
+        std::size_t k;
+    };
+
+    std::vector<frame> stack;
+
+    auto push = [&](std::size_t p_ix, std::uint32_t slot) {
+        const auto iters = g.arcs_from_v_lv(ps.at(p_ix).w_lw());
+        stack.push_back({ p_ix, slot, iters.first, iters.second, 0 });
+        if (ds[slot].len == std::size_t(-1)) {
+            ds[slot].len = 0;       // just so restart resets it only once
+            touched.push_back(slot);
+        }
+        ds[slot].mark_visited();
+    };
+
+    const std::uint32_t start = g.dsts.size();
+    if (to_end[start] <= max_len)
+        push(1, start);
+
+    while (!stack.empty()) {
+
+        frame& f = stack.back();
+        const path_arc& cur = ps.at(f.p_ix);
+        const std::size_t cur_len = ps.length(cur);
+
+            // the next arc to try, from the graph or from ovl
+
+        const arc* a = 0;
+        std::uint32_t d_ix = 0;
+
+        while (!a && f.it != f.it_end) {
+            const arc* c = &*f.it++;
+            if (!skip_twins || !is_twin(cur.w_lw(), *c))
+                a = c, d_ix = g.arc_dst(c);
+        }
+
+        while (!a && f.k < ovl.size()) {
+            const std::size_t k = f.k++;
+            if (ovl[k]->v() == cur.dst_v() && ovl[k]->v_lv >= cur.w_lw())
+                a = ovl[k], d_ix = g.dsts.size() + k;
+        }
+
+            // if none is left, back up
+
+        if (!a) {
+            ds[f.slot].p_ref = 0;
+            ps.truncate(f.p_ix);
+            stack.pop_back();
+            continue;
+        }
+
+            // skip the u-turn, slots on the path, and slots that are too far
+            // from the end to make it within max_len
+
+        const std::size_t len = cur_len + (a->v_lv - cur.w_lw());
+
+        if (a->w_lw == cur.v_lv() || ds[d_ix].is_visited()
+                || to_end[d_ix] > max_len || len > max_len - to_end[d_ix])
+            continue;
+
+        const std::size_t p_ix = ps.extend(f.p_ix, a);
+
+        if (a == end) {
+            ++n_found;
+            emit(p_ix);
+            ps.truncate(p_ix);
+        }
+        else
+            push(p_ix, d_ix);
+    }
+
+    verbose_emit("found %lu paths of length at most %lu", n_found, max_len);
+
+    return n_found;
+}
+
+
 } // namespace gfa
 
 // vim: sts=4:sw=4:ai:si:et
@@ -19,15 +19,19 @@
 #define dijkstra_h_INCLUDED
 
 #include <vector>
-#include <map>
-#include <set>
+#include <functional>
 #include "graph.h"
 #include "paths.h"
+#include "targets.h"
 
 namespace gfa {
 
 
 // dijkstra - structure to perform shortest path searches on a graph
+//
+// The searches run between targets (see targets.h), whose virtual arcs
+// are overlaid on the graph, which itself is only read.  A dijkstra holds
+// all state of a search, so any number can search the graph in parallel.
 
 struct dijkstra
 {
@@ -35,25 +39,48 @@ struct dijkstra
     paths ps;
     std::size_t found_pix;  // holds the index into ps when path is found
     std::size_t found_len;  // holds the length of the path that was found
+    std::vector<std::size_t> found_pixs;    // the indices of the paths found to several ends
+    std::size_t max_dist;   // the searches find no paths longer than this (default no limit)
+    bool meet_mid;          // shortest_path searches from both ends to meet in the middle (default off)
 
     dijkstra(const graph& gr)
-        : g(gr), ps(g) { restart(); }
+        : g(gr), ps(g), max_dist(std::size_t(-1)), meet_mid(false), vs(ds), bvs(bs) { restart(); }
 
         // finder functions
 
-    // shortest path from start to end arc, false if no path, sets found to its index
-    inline bool shortest_path(const arc* start, const arc* end) { return find_paths(start, end); }
+    // shortest path from START to END target, false if no path, sets found to its index
+    inline bool shortest_path(const target& from, const target& to)
+    { return meet_mid ? meet_paths(from, to) : find_paths(from, &to); }
 
-    // find the shortest paths from start to every destination in the graph, put their indices in ps
-    inline void shortest_paths(const arc* start) { find_paths(start); }  // to every destination
+    // find the shortest paths from START to every destination in the graph, put their indices in ps
+    inline void shortest_paths(const target& from) { find_paths(from); }  // to every destination
 
-    // find the shortest path to the destination arc that is furthest from start
+    // find the shortest paths from START to the first n (by default all) END targets reached
+    // of tos, which must have been set with their position in tos; puts the paths in found_pixs
+    // in the order reached, sets found to the first, and returns how many were reached
+    std::size_t shortest_paths(const target& from, const std::vector<const target*>& tos,
+            std::size_t n = std::size_t(-1));
+
+    // the index of the path the last search found to the i-th END target, or 0 if none
+    std::size_t path_to(std::size_t i) const;
+
+    // find the k shortest loopless paths from START to END target, put their indices in
+    // found_pixs in order of length, and set found to the first; returns how many were found
+    std::size_t top_paths(const target& from, const target& to, std::size_t k);
+
+    // enumerate all loopless paths from START to END target no longer than max_len, calling
+    // emit with the index of each as it is found, which is valid only during that call
+    std::size_t all_paths(const target& from, const target& to, std::size_t max_len,
+            const std::function<void(std::size_t)>& emit);
+
+    // find the shortest path to the destination arc that is furthest from START
     // NOTE: we do not currently detect or flag circular paths
-    void furthest_path(const arc* start);
+    void furthest_path(const target& from);
 
-//  // find the shortest path between the two arcs that are furthest apart, by iterating
-//  // (NON-OPTIMISED!) over all possible start arcs
-//  void furthest_path();
+    // find the longest of the shortest paths from any contig (on either strand) as START,
+    // i.e. the diameter of the graph, searching the contigs in parallel on n_threads;
+    // sets from to the START the path was found from, and found to the path
+    void furthest_path(target& from, std::size_t n_threads);
 
         // retrieval of route, sequence and length of a path
 
@@ -80,39 +107,182 @@ struct dijkstra
 #ifdef NDEBUG
     private:    // hide implementation detail as private unless debugging
 #endif
-        // clears all data structures for another search
-        void restart(const arc* start = 0);
+        // the length that found paths must stay below, from max_dist
+        inline std::size_t bound() const
+            { return max_dist == std::size_t(-1) ? max_dist : max_dist + 1; }
+
+        // clears all data structures for another search, overlays the arcs of
+        // the targets from and to, and seeds the forward search with from
+        void restart(const target* from, const target* const* tos, std::size_t n_tos);
+
+        inline void restart(const target* from = 0, const target* to = 0)
+            { restart(from, &to, to ? 1 : 0); }
+        inline void restart(const target* from, const std::vector<const target*>& tos)
+            { restart(from, tos.data(), tos.size()); }
 
         // the core finder function
-        bool find_paths(const arc* start, const arc* end = 0);
+        bool find_paths(const target& from, const target* to = 0);
+
+        // the bidirectional finder function: searches forward from START and
+        // backward from END at the same time, until they provably meet on the
+        // shortest path; the found path is then put in ps as if found forward
+        bool meet_paths(const target& from, const target& to);
+
+        // ovl - the virtual arcs of the targets in path order; the k-th has
+        // destination slot g.dsts.size()+k and arc index g.arcs.size()+k
+        std::vector<const arc*> ovl;
+
+        // shared - the copies in ovl of the arcs of END targets that share
+        // the START target segment (see restart)
+        std::vector<arc> shared;
+
+        // ovl_ix - the v_lv and index of the arcs in ovl, sorted for lookup
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> ovl_ix;
+
+        // ends - the destination slot of the terminal arc of each END target
+        std::vector<std::uint32_t> ends;
+
+        // the arc at arc index ix, in the graph or in ovl
+        inline const arc* arc_at(std::size_t ix) const
+            { return ix < g.arcs.size() ? &g.arcs[ix] : ovl[ix - g.arcs.size()]; }
+
+        // the destination (w_lw) of the slot, in the graph or in ovl
+        inline std::uint64_t dst_at(std::uint32_t slot) const
+            { return slot < g.dsts.size() ? g.dsts[slot] : ovl[slot - g.dsts.size()]->w_lw; }
 
         // dnode - pointer to current shortest path to a destination
         struct dnode {
 
+            static constexpr std::uint64_t VISITED = 0x8000000000000000L;
+
             std::size_t len;        // total path length upto path p_ref
             std::uint64_t p_ref;    // high bit marks visited, rest indexes into ps
 
             inline std::uint64_t p_ix() const { return p_ref & 0x7FFFFFFFFFFFFFFFL; }
             inline bool is_visited() const { return p_ref>>63; }
-            inline void mark_visited() { p_ref |= 0x8000000000000000L; }
+            inline void mark_visited() { p_ref |= VISITED; }
         };
 
-        // ds - map to look up the dnode for each destination (w_lw)
-        typedef std::map<std::uint64_t, dnode> dmap_t;
-        dmap_t ds;
+        // ds - the dnode for each destination, indexed by its slot in g.dsts
+        std::vector<dnode> ds;
+
+        // touched - the slots in ds that the last search set, so that restart
+        // resets only those rather than every destination in the graph
+        std::vector<std::uint32_t> touched;
+
+        // dheap - binary heap of destination slots ordered on path length
+        // (then on slot, i.e. w_lw), that tracks the heap position of each
+        // slot so that its length can be decreased in place
+        struct dheap {
+
+            static constexpr std::uint32_t NONE = std::uint32_t(-1);
+
+            const std::vector<dnode>& ds;
+            std::vector<std::uint32_t> heap;    // the slots in heap order
+            std::vector<std::uint32_t> pos;     // position in heap of each slot, or NONE
+
+            dheap(const std::vector<dnode>& d)
+                : ds(d) { }
+
+            inline std::uint32_t top() const { return heap.front(); }
+            inline std::size_t size() const { return heap.size(); }
+            inline bool empty() const { return heap.empty(); }
+            inline bool contains(std::uint32_t slot) const { return pos[slot] != NONE; }
+
+            // clears the heap of the given slots and sizes it for n slots
+            void reset(std::size_t n, const std::vector<std::uint32_t>& slots);
 
-        // comparator for keeping the vs ordered on length
-        struct nearest_dnode {
-            bool operator()(dmap_t::iterator const& i1, dmap_t::iterator const& i2) const noexcept {
-                return i1->second.len < i2->second.len || (i1->second.len == i2->second.len && i1->first < i2->first);
-            }
+            // adds slot to the heap, or restores its place after its len decreased
+            void push_or_update(std::uint32_t slot);
+
+            // removes and returns the slot with the shortest len
+            std::uint32_t pop();
+
+            private:
+                inline bool less(std::uint32_t s1, std::uint32_t s2) const
+                    { return ds[s1].len < ds[s2].len || (ds[s1].len == ds[s2].len && s1 < s2); }
+                void sift_up(std::size_t i);
+                void sift_down(std::size_t i);
         };
 
-        // vs - ordered set of visitable nodes sorted on increasing path length
-        std::set<dmap_t::iterator, nearest_dnode> vs;
+        // vs - heap of visitable nodes sorted on increasing path length
+        dheap vs;
 
         // pops the nearest visitable off the vs
         dnode& pop_visit();
+
+        // visits the nearest visitable, relaxing the arcs leaving it, returns it
+        dnode& visit_next();
+
+        // relaxes the arcs leaving the end of path cur_pix (of length cur_len), except
+        // those in bans if given
+        void relax_from(std::size_t cur_pix, std::size_t cur_len, const std::vector<const arc*>* bans = 0);
+
+        // lowers the length of slot d_ix to that over arc a from path cur_pix, if shorter
+        void relax(std::size_t cur_pix, std::size_t cur_len, const arc* cur_arc, const arc* a, std::uint32_t d_ix);
+
+        // the backward search mirrors the forward one: bs holds for each
+        // slot the shortest length from there to the end arc, with p_ref
+        // holding 1 + the arc index (see ovl) of the first arc on that path (0
+        // when the slot is the end arc's destination, which has length 0)
+        std::vector<dnode> bs;
+        std::vector<std::uint32_t> btouched;
+        dheap bvs;
+
+        // the end arc of the bidirectional search, or null when searching forward only
+        const arc* meet_end = 0;
+
+        // the shortest length and slot where the searches met so far
+        std::size_t meet_len;
+        std::uint32_t meet_slot;
+
+        // visits the nearest backward visitable, relaxing the arcs into it
+        void visit_back();
+
+        // lowers the backward length of slot to len over path ref, if shorter
+        void relax_back(std::uint32_t slot, std::size_t len, std::uint64_t ref);
+
+        // relaxes backward over arc a (with ref) the slots upstream of it: pre,
+        // the nearest in the graph (or NO_DST), and those in ovl, if len is
+        // the backward length at its destination
+        void relax_upstream(const arc& a, std::uint32_t pre, std::size_t len, std::uint64_t ref);
+
+        // records slot as meeting point if both searches reached it and are shorter
+        void meet(std::uint32_t slot);
+
+        // top_paths runs Yen's algorithm: each next shortest path deviates from
+        // an earlier one at some 'spur' slot, after following its 'root' there;
+        // the spur searches are bounded by the length a path must beat to make
+        // the top, using the (unconstrained) distances to the end as bounds
+        //
+        // An edge with overlap has an arc that leaves at the start of the
+        // overlap and lands at 0, and a 'twin' that leaves at its end and lands
+        // after it.  Paths that take either spell the same sequence, so when
+        // skip_twins is set, twins are not taken where the other arc can be.
+
+        bool skip_twins = false;
+
+        // whether a is the twin of an arc that can be taken from v_lv
+        bool is_twin(std::uint64_t v_lv, const arc& a) const;
+
+        // to_end - the length from each slot to the end arc, or INF if none
+        std::vector<std::size_t> to_end;
+        std::vector<std::uint32_t> to_end_touched;
+
+        // sets to_end by running the backward search to exhaustion
+        void find_to_end(const target& from, const target& to);
+
+        // searches for the shortest path that follows root up to and including
+        // its arc at spur_ix, then does not leave by any arc in bans, nor visits
+        // a slot on the root again, and is shorter than limit
+        bool spur_path(const target& from, const target& to, const std::vector<const arc*>& root,
+                std::size_t spur_ix, const std::vector<const arc*>& bans, std::size_t limit);
+
+        // the destination slot of arc a, which is in the graph or in ovl
+        std::uint32_t slot_of(const arc* a) const;
+
+        // the arcs of path p_ix in ps, from its start
+        std::vector<const arc*> arcs_of(std::size_t p_ix) const;
 };
 
 
@@ -0,0 +1,351 @@
+/* dna.cpp
+ *
+ * Copyright (C) 2021  Marco van Zwetselaar <io@zwets.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dna.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+namespace gfa {
+
+// the 2-bit code of each upper case character, or 4 if it is not ACGT
+static const std::uint8_t CODES[256] = {
+#define X4 4, 4, 4, 4
+#define X16 X4, X4, X4, X4
+    X16, X16, X16, X16,
+    4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4,     // @ A . C . . . G
+    4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,     // . . . . T
+    X16, X16, X16, X16, X16, X16, X16, X16, X16, X16
+#undef X16
+#undef X4
+};
+
+// the character for each code, and for its complement
+static const char BASES[4] = { 'A', 'C', 'G', 'T' };
+static const char RC_BASES[4] = { 'T', 'G', 'C', 'A' };
+
+// the complement of every IUPAC character, and 0 for anything else
+static const char RC_MAP[256] = {
+  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
+  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
+  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
+  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
+  0 , 'T', 'V', 'G', 'H',  0 ,  0 , 'C', 'D',  0 ,  0 , 'M',  0 , 'K', 'N',  0 ,
+  0 ,  0 , 'Y', 'W', 'A',  0 , 'B', 'S',  0 , 'R',  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
+  0 , 't', 'v', 'g', 'h',  0 ,  0 , 'c', 'd',  0 ,  0 , 'm',  0 , 'k', 'n',  0 ,
+  0 ,  0 , 'y', 'w', 'a',  0 , 'b', 's',  0 , 'r',  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
+  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
+  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
+  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
+  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
+  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
+  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
+  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
+  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0
+};
+
+// the complement of c if it is an IUPAC character, else c itself
+static inline char complement(unsigned char c)
+{
+    return RC_MAP[c] ? RC_MAP[c] : char(c);
+}
+
+// the code of the base at position i in bits
+static inline unsigned code_at(const std::uint64_t* bits, std::uint64_t i)
+{
+    return (bits[i>>5] >> ((i & 31) << 1)) & 3;
+}
+
+// the byte at index k in the bits holds bases 4k to 4k+3 (low bits first)
+// only on little endian, else we decode base by base; with SSSE3 we decode
+// sixteen bases at a time from four bytes, else by the byte tables; defining
+// GP_DNA_NO_BYTES or GP_DNA_NO_SIMD forces the fallbacks (for the tests)
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && !defined(GP_DNA_NO_BYTES)
+#define GP_DNA_BYTES 1
+#else
+#define GP_DNA_BYTES 0
+#endif
+
+#if GP_DNA_BYTES && defined(__SSSE3__) && !defined(GP_DNA_NO_SIMD)
+#define GP_DNA_SIMD 1
+#else
+#define GP_DNA_SIMD 0
+#endif
+
+#if GP_DNA_BYTES
+// the four characters for each byte of codes, forward and reverse complemented
+struct byte_tables {
+    char fwd[256][4];
+    char rc[256][4];
+};
+
+static const byte_tables& tables()
+{
+    static const byte_tables t = []() {
+        byte_tables t;
+        for (unsigned b = 0; b < 256; ++b)
+            for (unsigned j = 0; j < 4; ++j) {
+                t.fwd[b][j] = BASES[(b >> (j << 1)) & 3];
+                t.rc[b][3-j] = RC_BASES[(b >> (j << 1)) & 3];
+            }
+        return t;
+    }();
+    return t;
+}
+#endif
+
+#if GP_DNA_SIMD
+// lane j of the 16 takes its code from byte j/4, bits 2*(j%4); the low two
+// codes of a byte are masked in place, the high two after shifting down a
+// nibble, giving indices 0-3 or 0,4,8,12 into a lookup of 16 characters
+
+static const __m128i SPREAD = _mm_setr_epi8(0,0,0,0, 1,1,1,1, 2,2,2,2, 3,3,3,3);
+static const __m128i REVERSE = _mm_setr_epi8(15,14,13,12, 11,10,9,8, 7,6,5,4, 3,2,1,0);
+static const __m128i HI_LANES = _mm_setr_epi8(0,0,-1,-1, 0,0,-1,-1, 0,0,-1,-1, 0,0,-1,-1);
+static const __m128i CODE_MASK = _mm_setr_epi8(3,12,3,12, 3,12,3,12, 3,12,3,12, 3,12,3,12);
+static const __m128i FWD_LUT = _mm_setr_epi8('A','C','G','T', 'C',0,0,0, 'G',0,0,0, 'T',0,0,0);
+static const __m128i RC_LUT = _mm_setr_epi8('T','G','C','A', 'G',0,0,0, 'C',0,0,0, 'A',0,0,0);
+
+static inline __m128i codes16(const unsigned char* p)
+{
+    std::uint32_t w;
+    std::memcpy(&w, p, 4);
+    __m128i v = _mm_shuffle_epi8(_mm_cvtsi32_si128(w), SPREAD);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+    return _mm_and_si128(_mm_or_si128(_mm_andnot_si128(HI_LANES, v), _mm_and_si128(HI_LANES, hi)), CODE_MASK);
+}
+
+static inline void decode16(const unsigned char* p, char* out)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(FWD_LUT, codes16(p)));
+}
+
+static inline void decode16_rc(const unsigned char* p, char* out)
+{
+    __m128i c = _mm_shuffle_epi8(RC_LUT, codes16(p));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(c, REVERSE));
+}
+#endif
+
+// write the base at position i in bits to its place in out (see dna_ref::decode)
+static inline void
+put_base(const std::uint64_t* bits, char* out, std::uint64_t i, std::uint64_t beg, std::uint64_t end, bool rc)
+{
+    if (rc)
+        out[end - 1 - i] = RC_BASES[code_at(bits, i)];
+    else
+        out[i - beg] = BASES[code_at(bits, i)];
+}
+
+static inline bool is_lower(unsigned char c) { return c >= 'a' && c <= 'z'; }
+static inline bool is_upper(unsigned char c) { return c >= 'A' && c <= 'Z'; }
+
+// append position i to the runs in v, extending the last run if it ends at i and has chr
+static inline void add_to_runs(std::vector<dna::run>& v, std::uint32_t i, std::uint32_t chr)
+{
+    if (!v.empty() && v.back().beg + v.back().len == i && v.back().chr == chr)
+        ++v.back().len;
+    else
+        v.push_back({ i, 1, chr });
+}
+
+// the first of the n runs at v that ends after pos
+static inline const dna::run*
+first_run_after(const dna::run* v, std::size_t n, std::uint64_t pos)
+{
+    return std::partition_point(v, v + n,
+            [pos](const dna::run& r) { return r.beg + r.len <= pos; });
+}
+
+void
+dna::append(const char* s, std::size_t n)
+{
+    const std::uint64_t beg = len;
+
+    len += n;
+    bits.resize((len + 31) / 32, 0);
+
+    for (std::uint64_t i = beg; i < len; ++i) {
+
+        unsigned char c = s[i - beg];
+
+        if (is_lower(c)) {
+            add_to_runs(lowers, i, 0);
+            c -= 'a' - 'A';
+        }
+
+        std::uint64_t code = CODES[c];
+
+        if (code < 4)
+            bits[i>>5] |= code << ((i & 31) << 1);
+        else
+            add_to_runs(excs, i, c);
+    }
+}
+
+void
+dna::clear()
+{
+    len = 0;
+    std::vector<std::uint64_t>().swap(bits);
+    std::vector<run>().swap(excs);
+    std::vector<run>().swap(lowers);
+}
+
+void
+dna_ref::decode(char* out, std::uint64_t beg, std::uint64_t end, bool rc) const
+{
+    if (beg >= end)
+        return;
+
+        // the bases; out[k] is position beg+k, or end-1-k if rc
+
+    std::uint64_t n = end - beg;
+    std::uint64_t i = beg;
+
+    // one at a time up to a byte boundary (four bases to a byte)
+    for (; i < end && (i & 3); ++i)
+        put_base(bits, out, i, beg, end, rc);
+
+#if GP_DNA_BYTES
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(bits);
+
+#if GP_DNA_SIMD
+    // sixteen at a time from four bytes
+    for (; i + 16 <= end; i += 16)
+        if (rc)
+            decode16_rc(bytes + (i>>2), out + (end - i - 16));
+        else
+            decode16(bytes + (i>>2), out + (i - beg));
+#endif
+
+    // four at a time from a byte, using the byte tables
+    const byte_tables& t = tables();
+    for (; i + 4 <= end; i += 4)
+        if (rc)
+            std::memcpy(out + (end - i - 4), t.rc[bytes[i>>2]], 4);
+        else
+            std::memcpy(out + (i - beg), t.fwd[bytes[i>>2]], 4);
+#endif
+
+    // and the rest one at a time
+    for (; i < end; ++i)
+        put_base(bits, out, i, beg, end, rc);
+
+        // overlay the runs of other characters and of lower case
+
+    for (auto r = first_run_after(excs, n_excs, beg); r != excs + n_excs && r->beg < end; ++r) {
+        char c = rc ? complement(r->chr) : char(r->chr);
+        std::uint64_t b = std::max<std::uint64_t>(r->beg, beg) - beg;
+        std::uint64_t e = std::min<std::uint64_t>(r->beg + r->len, end) - beg;
+        if (rc)
+            std::fill(out + (n - e), out + (n - b), c);
+        else
+            std::fill(out + b, out + e, c);
+    }
+
+    for (auto r = first_run_after(lowers, n_lowers, beg); r != lowers + n_lowers && r->beg < end; ++r) {
+        std::uint64_t b = std::max<std::uint64_t>(r->beg, beg) - beg;
+        std::uint64_t e = std::min<std::uint64_t>(r->beg + r->len, end) - beg;
+        char *p0 = out + (rc ? n - e : b), *p1 = out + (rc ? n - b : e);
+        for (; p0 != p1; ++p0)
+            if (is_upper(*p0)) *p0 += 'a' - 'A';
+    }
+}
+
+std::ostream&
+dna_ref::write(std::ostream& os, bool rc, std::uint64_t beg, std::uint64_t end) const
+{
+    static const std::uint64_t BUF_SIZE = 16384;
+    char buf[BUF_SIZE];
+
+        // decode in blocks, from the far end backwards when rc
+
+    while (beg < end) {
+        std::uint64_t n = std::min(BUF_SIZE, end - beg);
+
+        if (rc) {
+            decode(buf, end - n, end, true);
+            end -= n;
+        }
+        else {
+            decode(buf, beg, beg + n, false);
+            beg += n;
+        }
+
+        os.write(buf, n);
+    }
+
+    return os;
+}
+
+std::string
+dna_ref::substr(std::size_t pos, std::size_t n) const
+{
+    if (pos > len)
+        pos = len;
+    if (n > len - pos)
+        n = len - pos;
+
+    std::string s(n, '\0');
+    decode(&s[0], pos, pos + n);
+    return s;
+}
+
+bool
+operator==(const dna_ref& a, const dna_ref& b)
+{
+    return a.len == b.len
+        && std::equal(a.bits, a.bits + (a.len + 31) / 32, b.bits)
+        && a.str() == b.str();
+}
+
+bool
+operator==(const dna_ref& d, const std::string& s)
+{
+    return d.length() == s.length() && d.str() == s;
+}
+
+bool
+operator==(const dna_ref& d, const char* s)
+{
+    return d == std::string(s);
+}
+
+std::ostream&
+operator<<(std::ostream& os, const dna_ref& d)
+{
+    return d.write(os, false, 0, d.len);
+}
+
+void
+reverse_complement(char* p, std::size_t n)
+{
+    std::reverse(p, p + n);
+
+    for (char* e = p + n; p != e; ++p)
+        *p = complement(*p);
+}
+
+} // namespace gfa
+
+// vim: sts=4:sw=4:ai:si:et
@@ -0,0 +1,155 @@
+/* dna.h
+ *
+ * Copyright (C) 2021  Marco van Zwetselaar <io@zwets.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef dna_h_INCLUDED
+#define dna_h_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+namespace gfa {
+
+struct dna_ref;
+
+/* dna - nucleotide sequence packed at two bits per base
+ *
+ * Bases A, C, G and T are stored in two bits each (A=0, C=1, G=2, T=3),
+ * 32 to a word, the first base in the least significant bits.  As the
+ * complement of a base is its code XOR 3, reverse complementing works on
+ * the codes rather than the characters.
+ *
+ * Anything other than ACGT goes into two sparse lists of runs: excs has
+ * the runs of a same other character (such as N or another IUPAC code),
+ * and lowers the runs of lower case (soft masked) sequence.  Assembly
+ * graph sequences are (almost) all ACGT, so this quarters their size.
+ *
+ * A dna converts implicitly from a string, so that a seg can be built as
+ * before, and it compares equal to the string it was made from.
+ */
+struct dna {
+
+    // a run of len positions from beg, for excs all having character chr
+    struct run {
+        std::uint32_t beg;
+        std::uint32_t len;
+        std::uint32_t chr;
+    };
+
+    std::uint64_t len = 0;
+    std::vector<std::uint64_t> bits;
+    std::vector<run> excs;
+    std::vector<run> lowers;
+
+    dna() { }
+    dna(const std::string& s) { assign(s.data(), s.length()); }
+    dna(const char* s) { assign(s, std::strlen(s)); }
+
+    // pack the n characters at s, reusing the memory already held
+    void assign(const char* s, std::size_t n) { len = 0; bits.clear(); excs.clear(); lowers.clear(); append(s, n); }
+
+    // pack the n characters at s after those already packed
+    void append(const char* s, std::size_t n);
+
+    // make empty and release the memory
+    void clear();
+
+    inline std::size_t length() const { return len; }
+    inline bool empty() const { return !len; }
+
+    // the packed data as a dna_ref, valid as long as this dna is not changed
+    inline dna_ref ref() const;
+
+    // write the characters in [beg,end) to out, reverse complemented if rc,
+    // in which case the characters written are those of end-1 down to beg,
+    // IUPAC codes complemented and other characters left as they are
+    inline void decode(char* out, std::uint64_t beg, std::uint64_t end, bool rc = false) const;
+
+    // write the characters in [beg,end) to os, reverse complemented if rc
+    inline std::ostream& write(std::ostream& os, bool rc, std::uint64_t beg, std::uint64_t end) const;
+
+    // unpack into a string
+    inline std::string str() const;
+    inline std::string substr(std::size_t pos, std::size_t n = std::string::npos) const;
+};
+
+/* dna_ref - packed nucleotide sequence held elsewhere
+ *
+ * The length of a dna and pointers to its bits, excs and lowers, which
+ * need not be in vectors of their own: a graph keeps those of all its
+ * segments together in an arena (see graph.h).  A dna_ref decodes and
+ * compares as the dna it refers to, which it does not own.
+ */
+struct dna_ref {
+
+    std::uint64_t len = 0;
+    const std::uint64_t* bits = 0;
+    const dna::run* excs = 0;
+    const dna::run* lowers = 0;
+    std::uint32_t n_excs = 0;
+    std::uint32_t n_lowers = 0;
+
+    inline std::size_t length() const { return len; }
+    inline bool empty() const { return !len; }
+
+    // as the dna functions of the same name
+    void decode(char* out, std::uint64_t beg, std::uint64_t end, bool rc = false) const;
+    std::ostream& write(std::ostream& os, bool rc, std::uint64_t beg, std::uint64_t end) const;
+
+    std::string str() const { return substr(0, len); }
+    std::string substr(std::size_t pos, std::size_t n = std::string::npos) const;
+};
+
+inline dna_ref dna::ref() const
+    { return { len, bits.data(), excs.data(), lowers.data(), std::uint32_t(excs.size()), std::uint32_t(lowers.size()) }; }
+
+inline void dna::decode(char* out, std::uint64_t beg, std::uint64_t end, bool rc) const
+    { ref().decode(out, beg, end, rc); }
+
+inline std::ostream& dna::write(std::ostream& os, bool rc, std::uint64_t beg, std::uint64_t end) const
+    { return ref().write(os, rc, beg, end); }
+
+inline std::string dna::str() const { return ref().str(); }
+inline std::string dna::substr(std::size_t pos, std::size_t n) const { return ref().substr(pos, n); }
+
+bool operator==(const dna_ref&, const dna_ref&);
+bool operator==(const dna_ref&, const std::string&);
+bool operator==(const dna_ref&, const char*);
+
+inline bool operator==(const dna& a, const dna& b) { return a.ref() == b.ref(); }
+inline bool operator==(const dna& d, const std::string& s) { return d.ref() == s; }
+inline bool operator==(const dna& d, const char* s) { return d.ref() == s; }
+
+template <typename T>
+inline bool operator!=(const dna& d, const T& t) { return !(d == t); }
+template <typename T>
+inline bool operator!=(const dna_ref& d, const T& t) { return !(d == t); }
+
+std::ostream& operator<<(std::ostream&, const dna_ref&);
+inline std::ostream& operator<<(std::ostream& os, const dna& d) { return os << d.ref(); }
+
+// reverse complement the n characters at p in place, as dna::decode does
+// (IUPAC codes are complemented, other characters are left as they are),
+// so that sequence read from FASTA is the same as sequence unpacked
+void reverse_complement(char* p, std::size_t n);
+
+} // namespace gfa
+
+#endif // dna_h_INCLUDED
+       // vim: sts=4:sw=4:ai:si:et
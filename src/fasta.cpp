@@ -0,0 +1,261 @@
+/* fasta.cpp
+ *
+ * Copyright (C) 2021  Marco van Zwetselaar <io@zwets.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fasta.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <istream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "dna.h"
+#include "utils.h"
+
+namespace gfa {
+
+using gene_paths::raise_error;
+
+constexpr std::size_t fasta_reader::BLOCK;
+
+fasta_reader::fasta_reader(const std::string& fname)
+    : buf(BLOCK)
+{
+    // gzread reads files that are not compressed as they are
+    gzFile f = gzopen(fname.c_str(), "rb");
+    if (!f)
+        raise_error("failed to open file: %s", fname.c_str());
+
+    gzbuffer(f, BLOCK);
+    gz = f;
+}
+
+fasta_reader::fasta_reader(std::istream& s)
+    : is(&s), buf(BLOCK)
+{
+}
+
+fasta_reader::~fasta_reader()
+{
+    if (gz)
+        gzclose(static_cast<gzFile>(gz));
+}
+
+bool
+fasta_reader::fill()
+{
+    std::size_t n = 0;
+
+    if (gz) {
+        int r = gzread(static_cast<gzFile>(gz), buf.data(), buf.size());
+        if (r < 0)
+            raise_error("failed to read FASTA: %s", gzerror(static_cast<gzFile>(gz), &r));
+        n = r;
+    }
+    else {
+        is->read(buf.data(), buf.size());
+        if (is->bad())
+            raise_error("failed to read FASTA");
+        n = is->gcount();
+    }
+
+    pos = buf.data();
+    end = pos + n;
+
+    return n != 0;
+}
+
+bool
+fasta_reader::next(std::string& id)
+{
+        // skip the rest of the current record (or the blank lines before
+        // the first), so that we are at the start of a header line
+
+    bool first = pos == 0;
+    read_seq([first](const char* p, std::size_t n) {
+        if (first)
+            raise_error("invalid FASTA header: %.*s", int(n), p);
+    });
+
+    if (pos == end && !fill())
+        return false;
+
+        // the id runs from after the '>' to the first white space, the
+        // rest of the header line is skipped
+
+    id.clear();
+    ++pos;
+    bool in_id = true;
+
+    while (pos != end || fill()) {
+
+        const char* p = pos;
+        while (p != end && *p != '\n' && (!in_id || !std::isspace(static_cast<unsigned char>(*p))))
+            ++p;
+
+        if (in_id)
+            id.append(pos, p);
+
+        if (p != end && *p == '\n') {
+            pos = p + 1;
+            bol = true;
+            return true;
+        }
+
+        in_id = in_id && p == end;
+        pos = p == end ? p : p + 1;
+    }
+
+    bol = true;
+    return true;
+}
+
+bool
+fasta_index::available(const std::string& fname)
+{
+    if (!std::ifstream(fname + ".fai"))
+        return false;
+
+    // the .fai of a bgzipped file has offsets in the decompressed data
+    unsigned char magic[2] = { 0, 0 };
+    std::ifstream(fname, std::ios::binary).read(reinterpret_cast<char*>(magic), 2);
+
+    return !(magic[0] == 0x1f && magic[1] == 0x8b);
+}
+
+fasta_index::fasta_index(const std::string& fn)
+    : fname(fn), fai(fn + ".fai")
+{
+    if (!fai)
+        raise_error("failed to open file: %s.fai", fname.c_str());
+
+    fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd == -1)
+        raise_error("failed to open file: %s", fname.c_str());
+}
+
+fasta_index::~fasta_index()
+{
+    if (fd != -1)
+        ::close(fd);
+}
+
+// parses the number at p, which must end at a tab or, if last, the end of
+// the line, and moves p past the tab
+static std::uint64_t
+parse_fai_num(const char*& p, bool last, bool& ok)
+{
+    char* end;
+    std::uint64_t v = std::strtoull(p, &end, 10);
+
+    ok = ok && std::isdigit(static_cast<unsigned char>(*p)) && (*end == '\t' || (last && !*end));
+    p = *end ? end + 1 : end;
+
+    return v;
+}
+
+bool
+fasta_index::next(std::string& id, rec& r)
+{
+    while (std::getline(fai, line)) {
+
+        ++line_no;
+
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (line.empty())
+            continue;
+
+            // id len offset line_bases line_width (and qual_offset for FASTQ)
+
+        std::size_t tab = line.find('\t');
+        bool ok = tab != 0 && tab != std::string::npos;
+
+        if (ok) {
+            const char* p = line.c_str() + tab + 1;
+            r.file = this;
+            r.len = parse_fai_num(p, false, ok);
+            r.offset = parse_fai_num(p, false, ok);
+            r.line_bases = parse_fai_num(p, false, ok);
+            r.line_width = parse_fai_num(p, true, ok);
+        }
+
+        if (!ok || !r.line_bases || r.line_width < r.line_bases)
+            raise_error("invalid line %lu in FASTA index %s.fai: %s", line_no, fname.c_str(), line.c_str());
+
+        id.assign(line, 0, tab);
+        return true;
+    }
+
+    if (fai.bad())
+        raise_error("failed to read file: %s.fai", fname.c_str());
+
+    fai.close();
+    return false;
+}
+
+bool
+fasta_index::decode(const rec& r, char* out, std::uint64_t beg, std::uint64_t end, bool rc) const
+{
+    if (beg >= end)
+        return true;
+
+    if (end > r.len)
+        return false;
+
+        // read the bytes from beg up to end, including line ends, in one go,
+        // into a buffer that each thread keeps for all its reads
+
+    const std::uint64_t n = end - beg;
+    const std::uint64_t b = r.offset + beg / r.line_bases * r.line_width + beg % r.line_bases;
+    const std::uint64_t e = r.offset + (end-1) / r.line_bases * r.line_width + (end-1) % r.line_bases + 1;
+
+    static thread_local std::vector<char> buf;
+    buf.resize(e - b);
+
+    for (std::uint64_t got = 0; got < buf.size(); ) {
+        ssize_t k = ::pread(fd, buf.data() + got, buf.size() - got, b + got);
+        if (k <= 0) {
+            if (k < 0 && errno == EINTR)
+                continue;
+            return false;
+        }
+        got += k;
+    }
+
+        // and drop the line ends, which leaves n bases if the index is right
+
+    std::uint64_t k = 0;
+    for (char c : buf)
+        if (c != '\n' && c != '\r' && k++ < n)
+            out[k-1] = c;
+
+    if (k != n)
+        return false;
+
+    if (rc)
+        reverse_complement(out, n);
+
+    return true;
+}
+
+} // namespace gfa
+
+// vim: sts=4:sw=4:ai:si:et
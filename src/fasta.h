@@ -0,0 +1,161 @@
+/* fasta.h
+ *
+ * Copyright (C) 2021  Marco van Zwetselaar <io@zwets.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef fasta_h_INCLUDED
+#define fasta_h_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace gfa {
+
+/* fasta_reader - reads FASTA records in large blocks
+ *
+ * Reads from a file, which may be gzip compressed, or from a stream, in
+ * blocks of BLOCK bytes, and hands out the sequence of each record as the
+ * runs of characters between line ends, straight from the block.  Reading
+ * a line at a time into a string and appending it to another, to then
+ * copy that string once more, is what made large FASTA files slow.
+ *
+ * Use as:
+ *
+ *   while (r.next(id))
+ *       r.read_seq([&](const char* p, std::size_t n) { ... });
+ *
+ * where read_seq can be skipped for records that are of no interest.
+ */
+struct fasta_reader {
+
+    static constexpr std::size_t BLOCK = std::size_t(1) << 20;
+
+    // read from the file at fname, which is decompressed if gzipped
+    explicit fasta_reader(const std::string& fname);
+
+    // read from stream is
+    explicit fasta_reader(std::istream& is);
+
+    ~fasta_reader();
+
+    fasta_reader(const fasta_reader&) = delete;
+    fasta_reader& operator=(const fasta_reader&) = delete;
+
+    // move to the next record, skipping what is left of the current one,
+    // and set id to its identifier (up to the first white space in the
+    // header); returns false at the end of the input
+    bool next(std::string& id);
+
+    // call fn(p, n) with each run of sequence characters of the current
+    // record, until its end; fn must not hold on to p
+    template <typename Fn>
+    void read_seq(Fn fn);
+
+#ifdef NDEBUG
+    private:    // hide implementation detail as private unless debugging
+#endif
+        void* gz = 0;                   // the gzFile when reading a file
+        std::istream* is = 0;           // or the stream
+        std::vector<char> buf;
+        const char* pos = 0;            // the next character to read in buf
+        const char* end = 0;            // the end of the valid data in buf
+        bool bol = true;                // pos is at the beginning of a line
+
+        // refill buf, returns false if there is no more input
+        bool fill();
+};
+
+template <typename Fn>
+void
+fasta_reader::read_seq(Fn fn)
+{
+    while (pos != end || fill()) {
+
+        if (bol && *pos == '>')
+            return;
+
+        const char* eol = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        const char* e = eol ? eol : end;
+
+        // drop the carriage return of a CRLF line end
+        const char* ee = e != pos && e[-1] == '\r' ? e - 1 : e;
+        if (ee != pos)
+            fn(pos, std::size_t(ee - pos));
+
+        bol = eol != 0;
+        pos = eol ? eol + 1 : end;
+    }
+}
+
+/* fasta_index - random access to a FASTA file through its .fai index
+ *
+ * The .fai is the index that 'samtools faidx' writes next to the FASTA
+ * file.  It has a line for each record with its id, its length, the file
+ * offset of its first base, and the bases and bytes on each of its lines,
+ * which is all it takes to read any section of the record with a single
+ * pread.  This lets a graph leave its sequences in the file, and read only
+ * those it writes (see seg::decode in graph.h).
+ *
+ * Use next() to read the records from the .fai, and decode() to read their
+ * sections from the FASTA.  As decode() uses pread, threads can share it.
+ */
+struct fasta_index {
+
+    // the location of a record in the FASTA file, as given by the .fai
+    struct rec {
+        const fasta_index* file;
+        std::uint64_t len;          // length of the sequence
+        std::uint64_t offset;       // file offset of its first base
+        std::uint64_t line_bases;   // bases on each line but the last
+        std::uint64_t line_width;   // bytes on each line, including the line end
+    };
+
+    // true if FASTA file fname has a .fai index and is not compressed
+    static bool available(const std::string& fname);
+
+    // open FASTA file fname and its index fname.fai
+    explicit fasta_index(const std::string& fname);
+
+    ~fasta_index();
+
+    fasta_index(const fasta_index&) = delete;
+    fasta_index& operator=(const fasta_index&) = delete;
+
+    // read the next record from the .fai into id and r, returns false at its end
+    bool next(std::string& id, rec& r);
+
+    // write the characters in [beg,end) of record r to out, reverse
+    // complemented if rc, in which case as for dna::decode; returns false
+    // (rather than raise an error, as it may run on any thread) if the
+    // section is not in r, cannot be read, or the file does not match r
+    bool decode(const rec& r, char* out, std::uint64_t beg, std::uint64_t end, bool rc = false) const;
+
+#ifdef NDEBUG
+    private:    // hide implementation detail as private unless debugging
+#endif
+        std::string fname;
+        int fd = -1;                    // the FASTA file
+        std::ifstream fai;              // its index, while reading it
+        std::string line;
+        std::size_t line_no = 0;
+};
+
+} // namespace gfa
+
+#endif // fasta_h_INCLUDED
+       // vim: sts=4:sw=4:ai:si:et
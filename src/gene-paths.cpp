@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 #include <fstream>
@@ -24,30 +25,105 @@
 #include <string>
 #include <cstring>
 #include <cstdlib>
+#include <memory>
+#include <functional>
+#include <thread>
 #include "graph.h"
 #include "parser.h"
 #include "targets.h"
 #include "dijkstra.h"
+#include "index.h"
+#include "parallel.h"
 #include "utils.h"
 
 using namespace gene_paths;
 
 static const std::string USAGE(
 "Usage: gene-paths [OPTIONS] GFA_FILE FROM TO\n"
+"       gene-paths [OPTIONS] -q FILE GFA_FILE\n"
+"       gene-paths [OPTIONS] -m FILE GFA_FILE\n"
+"       gene-paths [OPTIONS] -u GFA_FILE [FROM]\n"
+"       gene-paths index [OPTIONS] GFA_FILE INDEX_FILE\n"
 "\n"
 "  Find the shortest path between locations FROM and TO in the genome\n"
 "  assembly graph in GFA_FILE.\n"
 "\n"
 "  OPTIONS\n"
-"   -b, --bidir       search for TO both upstream and downstream of FROM\n"
-"   -f, --fasta FILE  read sequences for GFA_FILE from FILE\n"
-"   -v, --verbose     write detailed progress information to stderr\n"
-"   -h, --help        print this information and exit\n"
+"   -b, --bidir         search for TO both upstream and downstream of FROM\n"
+"   -a, --all LEN       report all paths of length up to LEN\n"
+"   -d, --max-dist LEN  find no paths longer than LEN\n"
+"   -e, --meet          search from both FROM and TO until the searches meet\n"
+"   -f, --fasta FILE    read sequences for GFA_FILE from FILE (may be gzipped)\n"
+"   -k, --top K         report the K shortest paths rather than just one\n"
+"   -m, --matrix FILE   write the distances between the targets in FILE\n"
+"   -n, --native        use the native streaming GFA parser (less memory)\n"
+"   -q, --queries FILE  read FROM and TO pairs from FILE, see below\n"
+"   -r, --route-only    read no sequences and output paths without them\n"
+"   -t, --threads N     search queries on N threads (default 1, 0 = all cores)\n"
+"   -u, --furthest      find the longest of the shortest paths from FROM\n"
+"   -v, --verbose       write detailed progress information to stderr\n"
+"   -h, --help          print this information and exit\n"
 "\n"
 "  The path search looks for TO downstream of FROM.  Use option -b/--bidir\n"
 "  to also search for a path that has TO upstream of FROM.  Both paths (if\n"
 "  any exist) will be reported.\n"
 "\n"
+"  With -k/--top, up to K paths are reported in order of length, the\n"
+"  shortest first.  These are the K shortest paths that do not visit the\n"
+"  same location twice.\n"
+"\n"
+"  With -d/--max-dist, the search stops at distance LEN from FROM, which\n"
+"  makes it fast when only the neighbourhood of FROM is of interest.\n"
+"\n"
+"  With -e/--meet, the shortest path is searched from both ends at once,\n"
+"  which visits far fewer locations in a large graph.  When several paths\n"
+"  are equally short, it may report a different one than without -e.\n"
+"\n"
+"  With -a/--all, every such path of length up to LEN is reported, in no\n"
+"  particular order.  Note that their number can grow very large.\n"
+"\n"
+"  With -q/--queries, the graph is read once and each line of FILE that\n"
+"  has a FROM and TO (separated by whitespace) is searched in turn.  Blank\n"
+"  lines and lines starting with '#' are skipped.  For each query a line\n"
+"  is written with tab-separated columns FROM, TO, LENGTH, ROUTE, and\n"
+"  SEQUENCE, the latter three being '*' if no path was found.  With -b,\n"
+"  the inverse query (TO, FROM) is output on the next line.  With -k or\n"
+"  -a, each path found is output on a line of its own.  Queries are\n"
+"  searched in parallel with -t/--threads, and output in their order.\n"
+"  An invalid query is reported on stderr and output with '*' columns\n"
+"  (if it has a FROM and TO), the other queries are searched regardless,\n"
+"  and the exit status is then 1.\n"
+"\n"
+"  With -m/--matrix, each line of FILE has a target (in the FROM and TO\n"
+"  format below) and optionally a name for it.  The output is a matrix\n"
+"  with a row for each target as FROM and a column for each as TO, whose\n"
+"  cells have the shortest path length from FROM to TO, followed by + if\n"
+"  TO is on the same strand as given, or - if it is on the other strand\n"
+"  (whichever is nearer), or '*' if no path exists.  The rows are searched\n"
+"  in parallel with -t/--threads.\n"
+"\n"
+"  With -r/--route-only, only the segment lengths are read from GFA_FILE,\n"
+"  which loads much faster and takes far less memory.  The lengths come\n"
+"  from the LN tag or the GFA2 S line, else the length of the sequence.\n"
+"  Paths are output without their sequence (which is '*' with -q).  This\n"
+"  cannot be combined with -f/--fasta, and is required when GFA_FILE is\n"
+"  an index that was made with -r.\n"
+"\n"
+"  With -u/--furthest, the path is found that is the longest of all the\n"
+"  shortest paths from FROM to anywhere in the graph.  When FROM is not\n"
+"  given, the longest such path from any contig (on either strand) is\n"
+"  found, which measures the span of the graph.  This searches from\n"
+"  every contig, in parallel with -t/--threads.\n"
+"\n"
+"  With -f/--fasta and -n/--native, when FILE is not gzipped and has an\n"
+"  index FILE.fai (as made by 'samtools faidx FILE'), the sequences are\n"
+"  not loaded but read from FILE when output, which takes little memory.\n"
+"\n"
+"  The index command reads GFA_FILE (and the -f/--fasta FILE) and writes\n"
+"  the graph to INDEX_FILE in a binary format that loads much faster.\n"
+"  INDEX_FILE can then be given as the GFA_FILE in any of the above.\n"
+"  The index is specific to this version of gene-paths and machine type.\n"
+"\n"
 "  FROM and TO are specified as CTG[:BEG[:END]]S, where CTG is the name of\n"
 "  the contig, BEG and END are the optional start and end positions on CTG,\n"
 "  and S is the mandatory strand identifier (+ or -).\n"
@@ -80,17 +156,117 @@ static void usage_exit(int err = 1)
     std::exit(err);
 }
 
-static void write_path(const gfa::dijkstra& d)
+// writes the path p_ix that d found in FASTA format, or its header only if !seq
+static void write_path(const gfa::dijkstra& d, std::size_t p_ix, bool seq)
 {
-    if (d.found_pix) {
-        std::cout << ">PATH ";
-        d.write_route(std::cout);
-        std::cout << " (length " << d.length() << ")";
+    std::cout << ">PATH ";
+    d.write_route(std::cout, p_ix);
+    std::cout << " (length " << d.length(p_ix) << ")";
+    std::cout << std::endl;
+
+    if (seq) {
+        if (!d.write_sequence(std::cout, p_ix))
+            raise_error("failed to read sequence from FASTA file, or it does not match its index");
         std::cout << std::endl;
+    }
+}
 
-        d.write_sequence(std::cout);
-        std::cout << std::endl;
+// writes the path p_ix that d found as a row for the query from, to
+static void write_row(std::ostream& os, const std::string& from, const std::string& to, const gfa::dijkstra& d, std::size_t p_ix, bool seq)
+{
+    os << from << '\t' << to << '\t' << d.length(p_ix) << '\t';
+    d.write_route(os, p_ix);
+    os << '\t';
+    if (seq)
+        d.write_sequence(os, p_ix);
+    else
+        os << '*';
+    os << '\n';
+}
+
+// searches the paths from to as the options say: all up to max_len if it
+// is set, else the top paths, else the shortest; calls write for each
+static bool search(gfa::dijkstra& d, const gfa::target& from, const gfa::target& to,
+        std::size_t top, std::size_t max_len, const std::function<void(std::size_t)>& write)
+{
+    if (max_len != std::size_t(-1))
+        return d.all_paths(from, to, max_len, write);
+
+    if (top) {
+        d.top_paths(from, to, top);
+        for (std::size_t p_ix : d.found_pixs)
+            write(p_ix);
     }
+    else if (d.shortest_path(from, to))
+        write(d.found_pix);
+
+    return d.found_pix;
+}
+
+// searcher - the targets and search state of one worker in batch mode
+struct searcher {
+    gfa::target from, to;
+    gfa::dijkstra dijkstra;
+
+    searcher(const gfa::graph& g)
+        : from(g), to(g), dijkstra(g) { }
+};
+
+// matrix_searcher - the targets and search state of one worker in matrix mode,
+// where the END targets are every target on its own strand and on the other
+struct matrix_searcher {
+    gfa::target from;
+    std::vector<gfa::target> ends;
+    std::vector<const gfa::target*> tos;
+    gfa::dijkstra dijkstra;
+
+    matrix_searcher(const gfa::graph& g, const std::vector<std::pair<std::string, std::string>>& targets)
+        : from(g), dijkstra(g)
+    {
+        ends.reserve(2 * targets.size());
+
+        for (const auto& t : targets) {
+            std::string flip = t.first;
+            flip.back() = flip.back() == '+' ? '-' : '+';
+            ends.emplace_back(g);
+            ends.back().set(t.first, gfa::target::END, ends.size() - 1);
+            ends.emplace_back(g);
+            ends.back().set(flip, gfa::target::END, ends.size() - 1);
+        }
+
+        for (const gfa::target& t : ends)
+            tos.push_back(&t);
+    }
+};
+
+// reads the targets file for matrix mode into (target, name) pairs
+static std::vector<std::pair<std::string, std::string>> read_targets(const std::string& fname)
+{
+    std::ifstream file(fname);
+    if (!file)
+        raise_error("failed to open file: %s", fname.c_str());
+
+    std::vector<std::pair<std::string, std::string>> targets;
+    std::string line;
+    std::size_t line_no = 0;
+
+    while (std::getline(file, line))
+    {
+        ++line_no;
+
+        std::istringstream ss(line);
+        std::string ref, name, rest;
+
+        if (!(ss >> ref) || ref[0] == '#')
+            continue;
+
+        if ((ss >> name && ss >> rest) || (ref.back() != '+' && ref.back() != '-'))
+            raise_error("invalid target on line %lu of %s: %s", line_no, fname.c_str(), line.c_str());
+
+        targets.emplace_back(ref, name.empty() ? ref : name);
+    }
+
+    return targets;
 }
 
 int main (int /*argc*/, char *argv[])
@@ -99,8 +275,22 @@ int main (int /*argc*/, char *argv[])
 
     std::string gfa_fname;
     std::string fna_fname;
+    std::string qry_fname;
+    std::string mtx_fname;
     bool bidirectional = false;
     bool furthest = false;
+    bool route_only = false;
+    bool meet_mid = false;
+    std::size_t n_threads = 1;
+    std::size_t top = 0;
+    std::size_t max_len = std::size_t(-1);
+    std::size_t max_dist = std::size_t(-1);
+    gfa::parser_t parser = gfa::GFAKLUGE;
+
+        // check for the index command
+
+    bool indexing = argv[1] && !std::strcmp("index", argv[1]);
+    if (indexing) ++argv;
 
         // parse options
 
@@ -112,16 +302,56 @@ int main (int /*argc*/, char *argv[])
         else if (!std::strcmp("-h", *argv) || !std::strcmp("--help", *argv)) {
             usage_exit(0);
         }
-        // option is parsed and executed, just not documented in --help yet
         else if (!std::strcmp("-u", *argv) || !std::strcmp("--furthest", *argv)) {
             furthest = true;
         }
         else if (!std::strcmp("-b", *argv) || !std::strncmp("--bidir", *argv, 7)) {
             bidirectional = true;
         }
+        else if (!std::strcmp("-e", *argv) || !std::strcmp("--meet", *argv)) {
+            meet_mid = true;
+        }
+        else if (!std::strcmp("-n", *argv) || !std::strcmp("--native", *argv)) {
+            parser = gfa::NATIVE;
+        }
+        else if (!std::strcmp("-r", *argv) || !std::strcmp("--route-only", *argv)) {
+            route_only = true;
+        }
         else if ((!std::strcmp("-f", *argv) || !std::strcmp("--fasta", *argv)) && *++argv) {
             fna_fname = *argv;
         }
+        else if ((!std::strcmp("-a", *argv) || !std::strcmp("--all", *argv)) && *++argv) {
+            char *end;
+            max_len = std::strtoul(*argv, &end, 10);
+            if (*end || **argv == '-')
+                usage_exit();
+        }
+        else if ((!std::strcmp("-d", *argv) || !std::strcmp("--max-dist", *argv)) && *++argv) {
+            char *end;
+            max_dist = std::strtoul(*argv, &end, 10);
+            if (*end || **argv == '-')
+                usage_exit();
+        }
+        else if ((!std::strcmp("-k", *argv) || !std::strcmp("--top", *argv)) && *++argv) {
+            char *end;
+            top = std::strtoul(*argv, &end, 10);
+            if (*end || **argv == '-' || !top)
+                usage_exit();
+        }
+        else if ((!std::strcmp("-q", *argv) || !std::strcmp("--queries", *argv)) && *++argv) {
+            qry_fname = *argv;
+        }
+        else if ((!std::strcmp("-m", *argv) || !std::strcmp("--matrix", *argv)) && *++argv) {
+            mtx_fname = *argv;
+        }
+        else if ((!std::strcmp("-t", *argv) || !std::strcmp("--threads", *argv)) && *++argv) {
+            char *end;
+            n_threads = std::strtoul(*argv, &end, 10);
+            if (*end || **argv == '-')
+                usage_exit();
+            if (!n_threads)
+                n_threads = std::max(1U, std::thread::hardware_concurrency());
+        }
         else {
             usage_exit();
         }
@@ -129,65 +359,312 @@ int main (int /*argc*/, char *argv[])
 
         // parse arguments
 
-    if (!*argv) usage_exit();
+    if (!*argv || (furthest && (top || max_len != std::size_t(-1))) || (route_only && !fna_fname.empty())) usage_exit();
     gfa_fname = *argv++;
 
     std::ifstream gfa_file(gfa_fname);
     if (!gfa_file)
         raise_error("failed to open file: %s", gfa_fname.c_str());
 
-    if (!*argv) usage_exit();
-    std::string from_ref = *argv++;
+    std::string idx_fname;
+    if (indexing) {
+        if (!*argv || !qry_fname.empty() || furthest) usage_exit();
+        idx_fname = *argv++;
+    }
+
+    std::ifstream qry_file;
+    if (!qry_fname.empty()) {
+        if (furthest) usage_exit();
+        qry_file.open(qry_fname);
+        if (!qry_file)
+            raise_error("failed to open file: %s", qry_fname.c_str());
+    }
+
+    std::vector<std::pair<std::string, std::string>> mtx_targets;
+    if (!mtx_fname.empty()) {
+        if (indexing || furthest || !qry_fname.empty() || top || max_len != std::size_t(-1)) usage_exit();
+        mtx_targets = read_targets(mtx_fname);
+    }
+
+    std::string from_ref;
+    if (qry_fname.empty() && mtx_fname.empty() && !indexing && (*argv || !furthest)) {
+        if (!*argv) usage_exit();
+        from_ref = *argv++;
+    }
 
     std::string to_ref;
-    if (!furthest && *argv)
+    if (qry_fname.empty() && mtx_fname.empty() && !indexing && !furthest && *argv)
         to_ref = *argv++;
 
     if (*argv) usage_exit();
 
-        // read GFA (and FASTA) into graph,
-        // reserving 3 segs and 4 arcs for the targets (see paths.h)
+        // read GFA (and FASTA) or the index into graph
 
     gfa::graph g;
 
-    verbose_emit("reading GFA file: %s", gfa_fname.c_str());
-    if (!fna_fname.empty()) {
+    if (gfa::is_index(gfa_fname)) {
 
-        std::ifstream fna_file(fna_fname);
-        if (!fna_file)
-            raise_error("failed to open file: %s", fna_fname.c_str());
-        verbose_emit("reading FASTA from file: %s", fna_fname.c_str());
+        if (!fna_fname.empty() || indexing)
+            raise_error("file is an index, not a GFA file: %s", gfa_fname.c_str());
+
+        verbose_emit("reading index file: %s", gfa_fname.c_str());
+        g = gfa::read_index(gfa_fname);
+    }
+    else if (!fna_fname.empty() && parser == gfa::NATIVE && !indexing && gfa::fasta_index::available(fna_fname)) {
+
+        verbose_emit("reading GFA file: %s", gfa_fname.c_str());
+
+        verbose_emit("reading FASTA index: %s.fai", fna_fname.c_str());
+        g = gfa::parse_lazy(gfa_file, fna_fname);
+    }
+    else if (!fna_fname.empty()) {
+
+        verbose_emit("reading GFA file: %s", gfa_fname.c_str());
 
-        g = gfa::parse(gfa_file, fna_file, 3, 4);
+        verbose_emit("reading FASTA from file: %s", fna_fname.c_str());
+        g = gfa::parse(gfa_file, fna_fname, parser);
+    }
+    else if (route_only) {
+        verbose_emit("reading GFA file (lengths only): %s", gfa_fname.c_str());
+        g = gfa::parse_lengths(gfa_file, parser);
     }
     else {
-        g = gfa::parse(gfa_file, 3, 4);
+        verbose_emit("reading GFA file: %s", gfa_fname.c_str());
+        g = gfa::parse(gfa_file, parser);
+    }
+
+    if (!route_only && !g.has_data())
+        raise_error("graph has no sequences, use -r/--route-only: %s", gfa_fname.c_str());
+
+        // if we are indexing, write the graph and we're done
+
+    if (indexing)
+    {
+        verbose_emit("writing index file: %s", idx_fname.c_str());
+
+        std::ofstream idx_file(idx_fname, std::ios::binary);
+        if (!idx_file)
+            raise_error("failed to open file: %s", idx_fname.c_str());
+
+        gfa::write_index(g, idx_file);
+        return 0;
     }
 
         // set up for program return value
 
     bool success = true;
 
-        // create targets on the graph, and set the from
+        // if we have a queries file, search each FROM TO pair on it
 
-    gfa::target from(g), to(g);
+    if (qry_file.is_open())
+    {
+            // one searcher per worker, reused for all queries it takes;
+            // the graph is shared, as targets only overlay it
+
+        std::vector<std::unique_ptr<searcher>> searchers;
+        for (std::size_t i = 0; i < n_threads; ++i) {
+            searchers.emplace_back(new searcher(g));
+            searchers.back()->dijkstra.max_dist = max_dist;
+            searchers.back()->dijkstra.meet_mid = meet_mid;
+        }
 
-    from.set(from_ref, gfa::target::START);
+            // read the queries in chunks, search each chunk in parallel,
+            // then write its results in order; an invalid query does not
+            // stop the batch, but is reported when its turn comes
+
+        const std::size_t chunk_size = 64 * n_threads;
+
+        struct query {
+            std::size_t line_no;
+            std::string from, to;   // both empty if the line is invalid
+            std::string error;      // why the query failed, if it did
+        };
+
+        std::vector<query> queries;
+        std::vector<std::string> results;
+
+        std::string line;
+        std::size_t line_no = 0;
+        bool more = true;
+
+        while (more)
+        {
+            queries.clear();
+
+            while (queries.size() < chunk_size && (more = bool(std::getline(qry_file, line))))
+            {
+                ++line_no;
+
+                std::istringstream ss(line);
+                std::string q_from, q_to, rest;
+
+                if (!(ss >> q_from) || q_from[0] == '#')
+                    continue;
+
+                if (!(ss >> q_to) || ss >> rest)
+                    queries.push_back({ line_no, std::string(), std::string(), "invalid query: " + line });
+                else
+                    queries.push_back({ line_no, q_from, q_to, std::string() });
+            }
 
-        // create dijkstra algorithm and point it at the graph
+            results.assign(queries.size(), std::string());
 
+            parallel_for(n_threads, queries.size(), [&](std::size_t w, std::size_t i) {
+
+                query& q = queries[i];
+                if (!q.error.empty())
+                    return;
+
+                searcher& sr = *searchers[w];
+                const std::string& q_from = q.from;
+                const std::string& q_to = q.to;
+                std::ostringstream os;
+
+                if (!sr.from.try_set(q_from, gfa::target::START, 0, q.error) ||
+                    !sr.to.try_set(q_to, gfa::target::END, 0, q.error))
+                    return;
+
+                verbose_emit("searching shortest path: %s -> %s", q_from.c_str(), q_to.c_str());
+
+                if (!search(sr.dijkstra, sr.from, sr.to, top, max_len,
+                        [&](std::size_t p_ix) { write_row(os, q_from, q_to, sr.dijkstra, p_ix, !route_only); }))
+                    os << q_from << '\t' << q_to << "\t*\t*\t*\n";
+
+                if (bidirectional)
+                {
+                    verbose_emit("searching inverse path: %s -> %s", q_to.c_str(), q_from.c_str());
+
+                    // both were valid above, so these cannot raise an error
+                    sr.from.set(q_to, gfa::target::START);
+                    sr.to.set(q_from, gfa::target::END);
+
+                    if (!search(sr.dijkstra, sr.from, sr.to, top, max_len,
+                            [&](std::size_t p_ix) { write_row(os, q_to, q_from, sr.dijkstra, p_ix, !route_only); }))
+                        os << q_to << '\t' << q_from << "\t*\t*\t*\n";
+                }
+
+                if (!os)    // a path sequence could not be read from the FASTA file
+                    q.error = "failed to read sequence from FASTA file, or it does not match its index: " + fna_fname;
+                else
+                    results[i] = os.str();
+            });
+
+                // write the results, and in their place the errors, which
+                // for a query with a FROM and TO is followed by its '*' row(s)
+
+            for (std::size_t i = 0; i < queries.size(); ++i) {
+
+                const query& q = queries[i];
+
+                if (q.error.empty()) {
+                    std::cout << results[i];
+                    continue;
+                }
+
+                std::cout.flush();
+                report_error("query on line %lu of %s: %s", q.line_no, qry_fname.c_str(), q.error.c_str());
+                success = false;
+
+                if (!q.from.empty()) {
+                    std::cout << q.from << '\t' << q.to << "\t*\t*\t*\n";
+                    if (bidirectional)
+                        std::cout << q.to << '\t' << q.from << "\t*\t*\t*\n";
+                }
+            }
+
+            std::cout.flush();
+        }
+
+        return success ? 0 : 1;
+    }
+
+        // if we have a targets file, write the matrix of their distances
+
+    if (!mtx_fname.empty())
+    {
+        const std::size_t n = mtx_targets.size();
+
+            // one searcher per worker, each with every target on both
+            // strands as END targets, so a single search finds all
+
+        std::vector<std::unique_ptr<matrix_searcher>> searchers;
+        for (std::size_t i = 0; i < n_threads; ++i) {
+            searchers.emplace_back(new matrix_searcher(g, mtx_targets));
+            searchers.back()->dijkstra.max_dist = max_dist;
+        }
+
+        std::vector<std::string> rows(n);
+
+        parallel_for(n_threads, n, [&](std::size_t w, std::size_t i) {
+
+            matrix_searcher& sr = *searchers[w];
+            std::ostringstream os;
+
+            verbose_emit("searching paths from: %s", mtx_targets[i].first.c_str());
+
+            sr.from.set(mtx_targets[i].first, gfa::target::START);
+            sr.dijkstra.shortest_paths(sr.from, sr.tos);
+
+            os << mtx_targets[i].second;
+
+            for (std::size_t j = 0; j < n; ++j) {
+
+                const std::size_t p_same = sr.dijkstra.path_to(2*j);
+                const std::size_t p_flip = sr.dijkstra.path_to(2*j + 1);
+
+                os << '\t';
+
+                if (p_same && (!p_flip || sr.dijkstra.length(p_same) <= sr.dijkstra.length(p_flip)))
+                    os << sr.dijkstra.length(p_same) << '+';
+                else if (p_flip)
+                    os << sr.dijkstra.length(p_flip) << '-';
+                else
+                    os << '*';
+            }
+
+            os << '\n';
+            rows[i] = os.str();
+        });
+
+        for (const auto& t : mtx_targets)
+            std::cout << '\t' << t.second;
+        std::cout << '\n';
+
+        for (const std::string& r : rows)
+            std::cout << r;
+
+        return 0;
+    }
+
+        // create targets on the graph, and the dijkstra algorithm on it
+
+    gfa::target from(g), to(g);
     gfa::dijkstra dijkstra(g);
+    dijkstra.max_dist = max_dist;
+    dijkstra.meet_mid = meet_mid;
+
+    if (furthest && from_ref.empty()) // find longest of all shortest paths in the graph
+    {
+        verbose_emit("searching furthest path from every contig");
+
+        dijkstra.furthest_path(from, n_threads);
+        if (dijkstra.found_pix)
+            write_path(dijkstra, dijkstra.found_pix, !route_only);
 
-        // @TODO@ document the -u/--furthest option
-        // it finds the shortest path from FROM to every possible TO,
-        // then returns the longest of these shortest paths
+        return 0;
+    }
+
+        // set the from
+
+    from.set(from_ref, gfa::target::START);
 
     if (furthest) // find longest of all shortest paths from FROM
     {
         verbose_emit("searching furthest path from: %s", from_ref.c_str());
 
-        dijkstra.furthest_path(from.p_arc());
-        write_path(dijkstra);
+        dijkstra.furthest_path(from);
+        if (dijkstra.found_pix)
+            write_path(dijkstra, dijkstra.found_pix, !route_only);
     }
     else // find shortest path from FROM to TO
     {
@@ -195,8 +672,8 @@ int main (int /*argc*/, char *argv[])
 
         to.set(to_ref, gfa::target::END);
 
-        success = dijkstra.shortest_path(from.p_arc(), to.p_arc());
-        write_path(dijkstra);
+        success = search(dijkstra, from, to, top, max_len,
+                [&](std::size_t p_ix) { write_path(dijkstra, p_ix, !route_only); });
 
         if (bidirectional) // also find shortest path with TO upstream of FROM
         {
@@ -205,8 +682,8 @@ int main (int /*argc*/, char *argv[])
             from.set(to_ref, gfa::target::START);
             to.set(from_ref, gfa::target::END);
 
-            success |= dijkstra.shortest_path(from.p_arc(), to.p_arc());
-            write_path(dijkstra);
+            success |= search(dijkstra, from, to, top, max_len,
+                    [&](std::size_t p_ix) { write_path(dijkstra, p_ix, !route_only); });
         }
 
         if (!success) {
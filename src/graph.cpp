@@ -22,7 +22,7 @@
 #include <vector>
 #include <algorithm>
 #include <ostream>
-#include <map>
+#include <cstring>
 #include "gfa2logic.h"
 #include "utils.h"
 
@@ -30,24 +30,11 @@ namespace gfa {
 
 using gene_paths::raise_error;
 
-static const char RC_MAP[256] = {
-  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
-  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
-  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
-  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
-  0 , 'T', 'V', 'G', 'H',  0 ,  0 , 'C', 'D',  0 ,  0 , 'M',  0 , 'K', 'N',  0 ,
-  0 ,  0 , 'Y', 'W', 'A',  0 , 'B', 'S',  0 , 'R',  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
-  0 , 't', 'v', 'g', 'h',  0 ,  0 , 'c', 'd',  0 ,  0 , 'm',  0 , 'k', 'n',  0 ,
-  0 ,  0 , 'y', 'w', 'a',  0 , 'b', 's',  0 , 'r',  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
-  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
-  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
-  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
-  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
-  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
-  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
-  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,
-  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0
-};
+std::ostream&
+operator<<(std::ostream& os, const name_ref& n)
+{
+    return os.write(n.data(), n.length());
+}
 
 std::ostream& 
 seg::write_seq(std::ostream& os, bool rc, std::uint32_t beg, std::uint32_t end) const
@@ -55,15 +42,15 @@ seg::write_seq(std::ostream& os, bool rc, std::uint32_t beg, std::uint32_t end)
     if (end == std::uint32_t(-1))
         end = len;
 
-    const char *p0 = data.data() + beg;
-    const char *p1 = data.data() + end;
-
-    if (rc)
-        while (p1 != p0) os << RC_MAP[std::size_t(*--p1)]; 
-    else
-        while (p0 != p1) os << *p0++;
+    if (!fai)
+        return data.write(os, rc, beg, end);
 
-    return os;
+    std::string buf(end > beg ? end - beg : 0, '\0');
+    if (!decode(&buf[0], beg, end, rc)) {
+        os.setstate(std::ios::failbit);
+        return os;
+    }
+    return os.write(buf.data(), buf.size());
 }
 
 static bool // for lower_bound - returns true when it is before v_lv
@@ -78,48 +65,179 @@ arc_less_u(const arc& a, const arc& it)
     return a.v_lv < it.v_lv || (a.v_lv == it.v_lv && a.w_lw < it.w_lw);
 }
 
-const seg*
-graph::find_seg(const std::string& name) const
+constexpr std::uint32_t name_index::EMPTY;
+
+std::uint64_t
+name_index::hash(const char* name, std::size_t n)
 {
-    const auto it = seg_ixs.find(name);
-    return it == seg_ixs.cend() ? 0 : &(segs[it->second]);
+    std::uint64_t h = 0;
+
+        // all digits (and not too many): the value itself, else FNV-1a
+
+    if (n && n < 20 && *name != '0') {
+        const char* p = name;
+        while (p != name + n && *p >= '0' && *p <= '9')
+            h = h * 10 + (*p++ - '0');
+        if (p == name + n)
+            return h * 0x9E3779B97F4A7C15UL;
+    }
+
+    h = 0xCBF29CE484222325UL;
+    for (const char* p = name; p != name + n; ++p)
+        h = (h ^ static_cast<unsigned char>(*p)) * 0x100000001B3UL;
+
+    return h ^ (h >> 29);
 }
 
 std::size_t
-graph::find_seg_ix(const std::string& name) const
+name_index::find(const std::vector<seg>& segs, const char* name, std::size_t n) const
 {
-    const auto it = seg_ixs.find(name);
-    return it == seg_ixs.cend() ? std::size_t(-1) : it->second;
+    if (slots.empty())
+        return std::size_t(-1);
+
+    const std::size_t mask = slots.size() - 1;
+
+    for (std::size_t i = hash(name, n) >> 32 & mask; slots[i] != EMPTY; i = (i + 1) & mask) {
+        const name_ref& s = segs[slots[i]].name;
+        if (s.length() == n && !std::memcmp(s.data(), name, n))
+            return slots[i];
+    }
+
+    return std::size_t(-1);
 }
 
-std::size_t
-graph::get_seg_ix(const std::string& name) const
+bool
+name_index::insert(const std::vector<seg>& segs, std::size_t ix)
 {
-    const auto it = seg_ixs.find(name);
-    if (it == seg_ixs.cend())
-        raise_error("unknown segment: %s", name.c_str());
-    return it->second;
+    const name_ref& name = segs[ix].name;
+
+    if (find(segs, name.data(), name.length()) != std::size_t(-1))
+        return false;
+
+        // keep the table at most half full, so that probes stay short
+
+    if (2 * (count + 1) > slots.size())
+        rehash(std::max(std::size_t(16), 2 * slots.size()), segs);
+
+    const std::size_t mask = slots.size() - 1;
+
+    std::size_t i = hash(name.data(), name.length()) >> 32 & mask;
+    while (slots[i] != EMPTY)
+        i = (i + 1) & mask;
+
+    slots[i] = ix;
+    ++count;
+
+    return true;
 }
 
 void
-graph::add_seg(const seg& s)
+name_index::reserve(const std::vector<seg>& segs, std::size_t n)
 {
-    if (s.name.empty())
-        raise_error("segment name is empty");
+    std::size_t n_slots = 16;
+    while (n_slots < 2 * n)
+        n_slots *= 2;
+
+    if (n_slots > slots.size())
+        rehash(n_slots, segs);
+}
+
+void
+name_index::rehash(std::size_t n_slots, const std::vector<seg>& segs)
+{
+    std::vector<std::uint32_t> old(n_slots, EMPTY);
+    slots.swap(old);
+
+    const std::size_t mask = slots.size() - 1;
+
+    for (std::uint32_t ix : old)
+        if (ix != EMPTY) {
+            const name_ref& name = segs[ix].name;
+            std::size_t i = hash(name.data(), name.length()) >> 32 & mask;
+            while (slots[i] != EMPTY)
+                i = (i + 1) & mask;
+            slots[i] = ix;
+        }
+}
+
+const seg*
+graph::find_seg(const std::string& name) const
+{
+    const std::size_t ix = seg_ixs.find(segs, name.data(), name.length());
+    return ix == std::size_t(-1) ? 0 : &segs[ix];
+}
 
+std::size_t
+graph::get_seg_ix(const char* name, std::size_t n) const
+{
+    const std::size_t ix = seg_ixs.find(segs, name, n);
+    if (ix == std::size_t(-1))
+        raise_error("unknown segment: %.*s", int(n), name);
+    return ix;
+}
+
+void
+graph::add_seg(const seg_def& s)
+{
     if (s.len != s.data.length())
         raise_error("segment length in GFA (%d) differs from FASTA (%d) for seqid %s", s.len, s.data.length(), s.name.c_str());
 
-    if (seg_ixs.find(s.name) != seg_ixs.end())
-        raise_error("duplicate segment name: %s", s.name.c_str());
+    set_data(add_seg(s.name.data(), s.name.length(), s.len), s.data);
+}
 
-    seg_ixs[s.name] = segs.size();
+std::size_t
+graph::add_seg(const char* name, std::size_t n, std::uint64_t len)
+{
+    if (!n)
+        raise_error("segment name is empty");
+
+    seg s;
+    s.len = len;
+    s.name = name_ref(name_arena.copy_str(name, n), n);
     segs.push_back(s);
+
+    if (!seg_ixs.insert(segs, segs.size() - 1))
+        raise_error("duplicate segment name: %.*s", int(n), name);
+
+    // the new vertices are last, so have no arcs yet
+    vtx_arcs.insert(vtx_arcs.end(), 2, arcs.size());
+
+    return segs.size() - 1;
 }
 
 void
-graph::add_edge(const std::string& sref, std::uint32_t sbeg, std::uint32_t send,
-                const std::string& dref, std::uint32_t dbeg, std::uint32_t dend)
+graph::set_data(std::size_t seg_ix, const dna& data)
+{
+    dna_ref& d = segs[seg_ix].data;
+
+    d.len = data.len;
+    d.bits = seq_arena.copy(data.bits.data(), data.bits.size());
+    d.excs = seq_arena.copy(data.excs.data(), data.excs.size());
+    d.lowers = seq_arena.copy(data.lowers.data(), data.lowers.size());
+    d.n_excs = data.excs.size();
+    d.n_lowers = data.lowers.size();
+}
+
+bool
+graph::has_data() const
+{
+    for (const seg& s : segs)
+        if (s.data_len() != s.len)
+            return false;
+
+    return true;
+}
+
+void
+graph::set_fai(std::size_t seg_ix, const fasta_index::rec& r)
+{
+    segs[seg_ix].fai = seq_arena.copy(&r, 1);
+}
+
+std::size_t
+graph::edge_arcs(arc (&as)[8],
+                 const std::string& sref, std::uint32_t sbeg, std::uint32_t send,
+                 const std::string& dref, std::uint32_t dbeg, std::uint32_t dend) const
 {
         // determine orientations and segment names
 
@@ -137,11 +255,8 @@ graph::add_edge(const std::string& sref, std::uint32_t sbeg, std::uint32_t send,
 
         // look up segments
 
-    std::string s_name(sref.cbegin(), ps);
-    std::string d_name(dref.cbegin(), pd);
-
-    std::size_t s_ix = get_seg_ix(s_name);
-    std::size_t d_ix = get_seg_ix(d_name);
+    std::size_t s_ix = get_seg_ix(sref.data(), ps - sref.cbegin());
+    std::size_t d_ix = get_seg_ix(dref.data(), pd - dref.cbegin());
 
     const seg& s_seg = segs[s_ix];
     const seg& d_seg = segs[d_ix];
@@ -163,34 +278,199 @@ graph::add_edge(const std::string& sref, std::uint32_t sbeg, std::uint32_t send,
     std::uint64_t vi = v^(1L<<32);
     std::uint64_t wi = w^(1L<<32);
 
-    if (edge.lv()  != 0 && edge.rw()  != 0) add_arc({ v |edge.lv(),  w |edge.lw()  });
-    if (edge.lw()  != 0 && edge.rv()  != 0) add_arc({ w |edge.lw(),  v |edge.lv()  });
-    if (edge.lvi() != 0 && edge.rwi() != 0) add_arc({ vi|edge.lvi(), wi|edge.lwi() });
-    if (edge.lwi() != 0 && edge.rvi() != 0) add_arc({ wi|edge.lwi(), vi|edge.lvi() });
+    std::size_t n = 0;
+
+    if (edge.lv()  != 0 && edge.rw()  != 0) as[n++] = { v |edge.lv(),  w |edge.lw()  };
+    if (edge.lw()  != 0 && edge.rv()  != 0) as[n++] = { w |edge.lw(),  v |edge.lv()  };
+    if (edge.lvi() != 0 && edge.rwi() != 0) as[n++] = { vi|edge.lvi(), wi|edge.lwi() };
+    if (edge.lwi() != 0 && edge.rvi() != 0) as[n++] = { wi|edge.lwi(), vi|edge.lvi() };
 
         // if non-zero overlap on either, add the second set of arcs
 
     if (edge.ov() != 0 || edge.ow() != 0) {
-        if (edge.lv2()  != 0 && edge.rw2()  != 0) add_arc({ v |edge.lv2(),  w |edge.lw2()  });
-        if (edge.lw2()  != 0 && edge.rv2()  != 0) add_arc({ w |edge.lw2(),  v |edge.lv2()  });
-        if (edge.lv2i() != 0 && edge.rw2i() != 0) add_arc({ vi|edge.lv2i(), wi|edge.lw2i() });
-        if (edge.lw2i() != 0 && edge.rv2i() != 0) add_arc({ wi|edge.lw2i(), vi|edge.lv2i() });
+        if (edge.lv2()  != 0 && edge.rw2()  != 0) as[n++] = { v |edge.lv2(),  w |edge.lw2()  };
+        if (edge.lw2()  != 0 && edge.rv2()  != 0) as[n++] = { w |edge.lw2(),  v |edge.lv2()  };
+        if (edge.lv2i() != 0 && edge.rw2i() != 0) as[n++] = { vi|edge.lv2i(), wi|edge.lw2i() };
+        if (edge.lw2i() != 0 && edge.rv2i() != 0) as[n++] = { wi|edge.lw2i(), vi|edge.lv2i() };
     }
+
+    return n;
+}
+
+void
+graph::add_edge(const std::string& sref, std::uint32_t sbeg, std::uint32_t send,
+                const std::string& dref, std::uint32_t dbeg, std::uint32_t dend)
+{
+    arc as[8];
+    std::size_t n = edge_arcs(as, sref, sbeg, send, dref, dbeg, dend);
+
+    for (std::size_t i = 0; i < n; ++i)
+        add_arc(as[i], false);
+
+    index_rev();
 }
 
 std::vector<arc>::iterator
-graph::add_arc(const arc& a)
+graph::add_arc(const arc& a, bool rev)
+{
+    std::uint64_t v = a.v();
+
+    if (v + 1 >= vtx_arcs.size())
+        raise_error("programmer error: arc from unknown vertex %lu", v);
+
+    auto it = arcs.insert(std::upper_bound(
+            arcs.cbegin() + vtx_arcs[v], arcs.cbegin() + vtx_arcs[v+1], a, arc_less_u), a);
+
+    for (auto p = vtx_arcs.begin() + v + 1; p != vtx_arcs.end(); ++p)
+        ++*p;
+
+    // number a new destination, shifting up the slots after it
+
+    auto d = std::lower_bound(dsts.begin(), dsts.end(), a.w_lw);
+    std::uint32_t d_ix = d - dsts.begin();
+
+    if (d == dsts.end() || *d != a.w_lw) {
+        dsts.insert(d, a.w_lw);
+        for (std::uint32_t& x : arc_dsts)
+            if (x >= d_ix) ++x;
+    }
+
+    arc_dsts.insert(arc_dsts.begin() + (it - arcs.begin()), d_ix);
+
+    if (rev)
+        index_rev();
+
+    return it;
+}
+
+void
+graph::remove_arc(const arc& a)
 {
-    return arcs.insert(std::upper_bound(arcs.cbegin(), arcs.cend(), a, arc_less_u), a);
+    auto iters = arcs_from_v_lv(a.v_lv);
+    auto it = iters.first;
+
+    while (it != iters.second && it->v_lv == a.v_lv && it->w_lw != a.w_lw)
+        ++it;
+
+    if (it == iters.second || it->v_lv != a.v_lv)
+        raise_error("programmer error: removing arc not in graph");
+
+    auto d = arc_dsts.begin() + (it - arcs.cbegin());
+    std::uint32_t d_ix = *d;
+
+    arcs.erase(it);
+    arc_dsts.erase(d);
+
+    for (auto p = vtx_arcs.begin() + a.v() + 1; p != vtx_arcs.end(); ++p)
+        --*p;
+
+    // drop the destination if no other arc has it, shifting down the slots
+
+    if (std::find(arc_dsts.cbegin(), arc_dsts.cend(), d_ix) == arc_dsts.cend()) {
+        dsts.erase(dsts.begin() + d_ix);
+        for (std::uint32_t& x : arc_dsts)
+            if (x > d_ix) --x;
+    }
+
+    index_rev();
+}
+
+void
+graph::index_arcs()
+{
+    vtx_arcs.assign((segs.size()<<1) + 1, 0);
+
+    // count the arcs per vertex, then turn counts into offsets
+    for (const arc& a : arcs)
+        ++vtx_arcs[a.v() + 1];
+
+    for (std::size_t i = 1; i < vtx_arcs.size(); ++i)
+        vtx_arcs[i] += vtx_arcs[i-1];
+
+    // collect the distinct destinations and give each arc its slot
+
+    dsts.clear();
+    dsts.reserve(arcs.size());
+    for (const arc& a : arcs)
+        dsts.push_back(a.w_lw);
+
+    std::sort(dsts.begin(), dsts.end());
+    dsts.erase(std::unique(dsts.begin(), dsts.end()), dsts.end());
+    dsts.shrink_to_fit();
+
+    arc_dsts.resize(arcs.size());
+    for (std::size_t i = 0; i < arcs.size(); ++i)
+        arc_dsts[i] = std::lower_bound(dsts.cbegin(), dsts.cend(), arcs[i].w_lw) - dsts.cbegin();
+
+    index_rev();
+}
+
+constexpr std::uint32_t graph::NO_DST;
+
+void
+graph::index_rev()
+{
+    // count the arcs into each slot, turn counts into offsets, then
+    // place the arcs, which leaves each group sorted on arc index
+
+    dst_arcs.assign(dsts.size() + 1, 0);
+
+    for (std::uint32_t d_ix : arc_dsts)
+        ++dst_arcs[d_ix + 1];
+
+    for (std::size_t i = 1; i < dst_arcs.size(); ++i)
+        dst_arcs[i] += dst_arcs[i-1];
+
+    rev_arcs.resize(arcs.size());
+    std::vector<std::size_t> next(dst_arcs.cbegin(), dst_arcs.cend() - 1);
+
+    for (std::size_t i = 0; i < arcs.size(); ++i)
+        rev_arcs[next[arc_dsts[i]]++] = i;
+
+    // both arcs and dsts are sorted, so one merging pass finds for each
+    // arc the last destination at or before its v_lv
+
+    arc_pres.resize(arcs.size());
+    std::size_t j = 0;
+
+    for (std::size_t i = 0; i < arcs.size(); ++i) {
+        while (j < dsts.size() && dsts[j] <= arcs[i].v_lv)
+            ++j;
+        arc_pres[i] = j && vlv_v(dsts[j-1]) == arcs[i].v() ? j-1 : NO_DST;
+    }
 }
 
 std::pair<std::vector<arc>::const_iterator, std::vector<arc>::const_iterator>
 graph::arcs_from_v_lv(std::uint64_t v_lv) const
 {
-    arc next = { ((v_lv>>32)+1)<<32, 0 };
-    std::vector<arc>::const_iterator lo = std::lower_bound(arcs.cbegin(), arcs.cend(), v_lv, v_lv_less_l);
+    auto iters = arcs_from_vtx(v_lv>>32);
+    iters.first = std::lower_bound(iters.first, iters.second, v_lv, v_lv_less_l);
+
+    return iters;
+}
+
+void
+graph_builder::add_edge(const std::string& sref, std::uint32_t sbeg, std::uint32_t send,
+                        const std::string& dref, std::uint32_t dbeg, std::uint32_t dend)
+{
+    arc as[8];
+    std::size_t n = g.edge_arcs(as, sref, sbeg, send, dref, dbeg, dend);
+
+    g.arcs.insert(g.arcs.end(), as, as + n);
+}
+
+static bool // for unique - returns true when arcs are identical
+arc_equal(const arc& a1, const arc& a2)
+{
+    return a1.v_lv == a2.v_lv && a1.w_lw == a2.w_lw;
+}
 
-    return std::make_pair(lo, std::upper_bound(lo, arcs.cend(), next, arc_less_u));
+void
+graph_builder::finalise()
+{
+    std::sort(g.arcs.begin(), g.arcs.end(), arc_less_u);
+    g.arcs.erase(std::unique(g.arcs.begin(), g.arcs.end(), arc_equal), g.arcs.end());
+    g.index_arcs();
 }
 
 
@@ -20,7 +20,12 @@
 
 #include <string>
 #include <vector>
-#include <map>
+#include <cstring>
+#include <iosfwd>
+#include <memory>
+#include "arena.h"
+#include "dna.h"
+#include "fasta.h"
 
 namespace gfa {
 
@@ -29,7 +34,10 @@ namespace gfa {
  * A segment is a sequence with length and data.  A vertex is one side of
  * the segment, and corresponds to the + or - orientation of the segment.
  * The sequence data in the + and - orientations are reverse complements.
- * Segments store the data for the + orientation.
+ * Segments store the data for the + orientation, packed (see dna.h),
+ * and the graph holds the names and data of all segments in two arenas.
+ * Alternatively, segments refer to their record in an indexed FASTA file
+ * that the graph holds open, and their data is read when it is written.
  *
  * Segments and vertices are identified by indices.  The two vertices of
  * segment seg_ix are given by seg_ix<<1|ori, thus seg_ix = vtx_ix>>1.
@@ -71,7 +79,9 @@ namespace gfa {
  *
  * As in gfatools, arcs are stored in an array sorted on v_lv, which is
  * vtx_ix<<32|lv, so that the outbound arcs from every vertex vtx_ix are
- * contiguous and sorted on how "early" they leave the vertex.
+ * contiguous and sorted on how "early" they leave the vertex.  An index
+ * in compressed sparse row format holds for every vertex the offset of
+ * its first outbound arc, so these are found without searching.
  *
  * -- Special case 1: ov = ow = 0 (X-shape)
  *
@@ -143,13 +153,67 @@ namespace gfa {
  * at 0.
  */
 
-struct seg {
+/* name_ref - a segment name held in the graph's name arena
+ *
+ * The characters are NUL-terminated, so c_str() is as for a string.
+ */
+struct name_ref {
+    const char* ptr = "";
+    std::size_t len = 0;
+
+    name_ref() { }
+    name_ref(const char* p, std::size_t n) : ptr(p), len(n) { }
+
+    inline const char* data() const { return ptr; }
+    inline const char* c_str() const { return ptr; }
+    inline std::size_t length() const { return len; }
+    inline bool empty() const { return !len; }
+    inline std::string str() const { return std::string(ptr, len); }
+};
+
+inline bool operator==(const name_ref& a, const name_ref& b)
+    { return a.len == b.len && !std::memcmp(a.ptr, b.ptr, a.len); }
+inline bool operator==(const name_ref& a, const std::string& b)
+    { return a.len == b.length() && !std::memcmp(a.ptr, b.data(), a.len); }
+inline bool operator==(const name_ref& a, const char* b)
+    { return a.len == std::strlen(b) && !std::memcmp(a.ptr, b, a.len); }
+template <typename T>
+inline bool operator!=(const name_ref& a, const T& b) { return !(a == b); }
+
+std::ostream& operator<<(std::ostream&, const name_ref&);
+
+/* seg_def - the definition of a segment, from which graph::add_seg adds it */
+struct seg_def {
     std::uint64_t len;
     std::string name;
-    std::string data;
+    dna data;
+};
+
+/* seg - a segment in the graph, whose name and packed data are views on
+ * the arenas of the graph, so that segments take no allocations of their
+ * own and can be copied cheaply (but are valid only with their graph)
+ */
+struct seg {
+    std::uint64_t len;
+    name_ref name;
+    dna_ref data;           // packed, see dna.h
+    const fasta_index::rec* fai = 0;    // or where to read it, see fasta.h
 
-    // writes the sequence content in [beg,end) to os, optionally reverse complementing
-    // note that beg and end are positions as in GFA2, i.e. before orienting the segment
+    // the length of the data, be it packed or in the FASTA file
+    inline std::uint64_t data_len() const { return fai ? fai->len : data.len; }
+
+    // decode the characters in [beg,end) into out, reverse complemented if rc,
+    // from the packed data or the FASTA file; as dna::decode, but returns
+    // false if reading the FASTA file failed, see fasta_index::decode
+    bool decode(char* out, std::uint64_t beg, std::uint64_t end, bool rc = false) const {
+        if (fai)
+            return fai->file->decode(*fai, out, beg, end, rc);
+        data.decode(out, beg, end, rc);
+        return true;
+    }
+
+    // writes the sequence content in [beg,end) to os, optionally reverse complementing,
+    // or sets failbit on os if it cannot be read from the FASTA file; note that beg and end are positions as in GFA2, i.e. before orienting the segment
     std::ostream& write_seq(std::ostream& os, bool rc = false, std::uint32_t beg = 0, std::uint32_t end = std::uint32_t(-1)) const;
 
     // write the sequence content in [beg,end) on the pos or neg vertex of the segment,
@@ -157,6 +221,36 @@ struct seg {
     std::ostream& write_vtx(std::ostream& os, bool neg, std::uint32_t beg = 0, std::uint32_t end = std::uint32_t(-1)) const {
         return neg ? write_seq(os, true, end == std::uint32_t(-1) ? 0 : len-end, len-beg) : write_seq(os, false, beg, end);
     }
+
+    // as write_vtx, but decodes the end-beg characters into out
+    bool decode_vtx(char* out, bool neg, std::uint32_t beg, std::uint32_t end) const {
+        return neg ? decode(out, len-end, len-beg, true) : decode(out, beg, end);
+    }
+};
+
+/* seg_view - a section of a segment, presented as a segment of its own
+ *
+ * The view has length len and its own name, and covers [beg, beg+len) of
+ * segment ref.  Its + and - vertices are the same sections of those of ref.
+ * Targets use views for their virtual segments, so need not copy sequence.
+ */
+struct seg_view {
+    std::uint64_t len;
+    std::string name;
+    const seg* ref;
+    std::uint64_t beg;
+
+    // as seg::write_vtx, with beg and end interpreted on the vertex of the view
+    std::ostream& write_vtx(std::ostream& os, bool neg, std::uint32_t b, std::uint32_t e) const {
+        std::uint64_t off = neg ? ref->len - beg - len : beg;
+        return ref->write_vtx(os, neg, b + off, e + off);
+    }
+
+    // as seg::decode_vtx, with b and e interpreted on the vertex of the view
+    bool decode_vtx(char* out, bool neg, std::uint32_t b, std::uint32_t e) const {
+        std::uint64_t off = neg ? ref->len - beg - len : beg;
+        return ref->decode_vtx(out, neg, b + off, e + off);
+    }
 };
 
 struct arc {
@@ -171,24 +265,94 @@ struct arc {
     inline std::uint64_t lw() const { return w_lw & 0xFFFFFFFFL; }
 };
 
+/* name_index - hash index of segments on their name
+ *
+ * A flat open-addressing table (probed linearly) that holds for each name
+ * just the index of its segment, and compares names with those of the
+ * segments themselves, so it keeps no copy of them.  Names that are all
+ * digits, as SPAdes and Unicycler write them, hash on their value, which
+ * is cheaper than hashing the characters.
+ */
+struct name_index {
+
+    // the index of the segment in segs named by the n characters at name, or size_t(-1)
+    std::size_t find(const std::vector<seg>& segs, const char* name, std::size_t n) const;
+
+    // index segs[ix] on its name, returns false (and does not) if the name is indexed
+    bool insert(const std::vector<seg>& segs, std::size_t ix);
+
+    // size the table to hold n names (of segs) without growing
+    void reserve(const std::vector<seg>& segs, std::size_t n);
+
+    inline std::size_t size() const { return count; }
+    inline bool empty() const { return !count; }
+
+    private:
+        static constexpr std::uint32_t EMPTY = std::uint32_t(-1);
+        std::vector<std::uint32_t> slots;   // segment index, or EMPTY
+        std::size_t count = 0;
+
+        static std::uint64_t hash(const char* name, std::size_t n);
+        void rehash(std::size_t n_slots, const std::vector<seg>& segs);
+};
+
 struct graph {
 
         // building the graph
 
-    void add_seg(const seg&);
+    void add_seg(const seg_def&);
+
+    // add_edge, add_arc and remove_arc keep the arcs sorted and indexed, each
+    // rebuilding the reverse index in O(A) for A arcs: to add many edges, use
+    // graph_builder, which indexes once; add_edge rebuilds once for its arcs
 
     void add_edge(const std::string& sref, std::uint32_t sbeg, std::uint32_t send,
                   const std::string& dref, std::uint32_t dbeg, std::uint32_t dend);
 
-    std::vector<arc>::iterator add_arc(const arc&);
+    // insert arc at its place; when !rev, the reverse index is left for the
+    // caller to rebuild with index_rev() before the graph is searched
+    std::vector<arc>::iterator add_arc(const arc&, bool rev = true);
+
+    void remove_arc(const arc&);
+
+    // add segment name (of n characters) with length len but no data, returning its
+    // index; the data can be set later, but the graph does not check it then
+    std::size_t add_seg(const char* name, std::size_t n, std::uint64_t len);
+
+    // set the data of segment seg_ix to a copy of data in the sequence arena
+    void set_data(std::size_t seg_ix, const dna& data);
+
+    // have segment seg_ix read its data from record r of the fasta file when needed
+    void set_fai(std::size_t seg_ix, const fasta_index::rec& r);
+
+    // compute the (up to eight) arcs for an edge into as, returns their count
+    std::size_t edge_arcs(arc (&as)[8],
+                  const std::string& sref, std::uint32_t sbeg, std::uint32_t send,
+                  const std::string& dref, std::uint32_t dbeg, std::uint32_t dend) const;
 
         // segment storage and lookup
 
     std::vector<seg> segs;
-    std::map<std::string, std::size_t> seg_ixs;
+    name_index seg_ixs;
+
+    // the storage of the names, and of the bits, excs and lowers of the data
+    arena name_arena;
+    arena seq_arena;
+
+    // the indexed FASTA file that segments with a fai read their data from
+    std::unique_ptr<fasta_index> fasta;
+
+    // false if the segments have their lengths only, see parse_lengths
+    bool has_data() const;
+
+    inline std::size_t find_seg_ix(const std::string& name) const   // ix or size_t(-1)
+        { return seg_ixs.find(segs, name.data(), name.length()); }
+    inline std::size_t get_seg_ix(const std::string& name) const    // ix or error out
+        { return get_seg_ix(name.data(), name.length()); }
 
-    std::size_t find_seg_ix(const std::string& name) const;     // ix or size_t(-1)
-    std::size_t get_seg_ix(const std::string& name) const;      // ix or error out
+    inline std::size_t find_seg_ix(const char* name, std::size_t n) const
+        { return seg_ixs.find(segs, name, n); }
+    std::size_t get_seg_ix(const char* name, std::size_t n) const;
 
     const seg* find_seg(const std::string& name) const;         // pointer or null
     inline const seg& get_seg(const std::string& name) const    // ref or error out
@@ -218,14 +382,75 @@ struct graph {
 
     std::vector<arc> arcs;
 
+    // index of the first arc leaving each vertex, plus past-the-end sentinel
+    std::vector<std::size_t> vtx_arcs = { 0 };
+
+    // the distinct destinations (w_lw) of the arcs, sorted, so that each has
+    // a dense "slot" number, and for every arc in arcs the slot of its w_lw
+    std::vector<std::uint64_t> dsts;
+    std::vector<std::uint32_t> arc_dsts;
+
+    // the reverse index: the indices of the arcs grouped on destination slot,
+    // with dst_arcs holding the offset of each slot's group, plus sentinel
+    std::vector<std::uint32_t> rev_arcs;
+    std::vector<std::size_t> dst_arcs = { 0 };
+
+    // for every arc in arcs the last destination slot on its vertex at or
+    // before its lv (where a backward search continues upstream), or NO_DST
+    static constexpr std::uint32_t NO_DST = std::uint32_t(-1);
+    std::vector<std::uint32_t> arc_pres;
+
+    // rebuild vtx_arcs, dsts, arc_dsts and the reverse index from the (sorted) arcs
+    void index_arcs();
+
+    // rebuild rev_arcs, dst_arcs and arc_pres from arcs, dsts and arc_dsts
+    void index_rev();
+
+    // return the destination slot of the arc at a (which must be in arcs)
+    inline std::size_t arc_dst(const arc* a) const { return arc_dsts[a - arcs.data()]; }
+
+    // begin and past-the-end pointer to the indices of all arcs into destination slot
+    inline std::pair<const std::uint32_t*, const std::uint32_t*>
+        arcs_into_dst(std::size_t slot) const {
+        return std::make_pair(rev_arcs.data() + dst_arcs[slot], rev_arcs.data() + dst_arcs[slot+1]);
+    }
+
     // begin and past-the-end iterator for all arcs leaving v at lv or further downstream
     std::pair<std::vector<arc>::const_iterator, std::vector<arc>::const_iterator>
         arcs_from_v_lv(std::uint64_t) const;
 
     // begin and past-the-end iterator for all arcs leaving vtx
     inline std::pair<std::vector<arc>::const_iterator, std::vector<arc>::const_iterator>
-        arcs_from_vtx(std::uint64_t vtx_ix) const
-        { return arcs_from_v_lv(vtx_ix<<32); }
+        arcs_from_vtx(std::uint64_t vtx_ix) const {
+        return vtx_ix + 1 < vtx_arcs.size()
+            ? std::make_pair(arcs.cbegin() + vtx_arcs[vtx_ix], arcs.cbegin() + vtx_arcs[vtx_ix+1])
+            : std::make_pair(arcs.cend(), arcs.cend());
+    }
+};
+
+/* graph_builder - bulk construction of a graph
+ *
+ * graph::add_arc keeps the arcs sorted by inserting each at its place,
+ * which costs moving half the arcs on average, so loading a graph with A
+ * arcs that way is O(A^2).  The builder instead appends arcs unsorted, and
+ * finalise() sorts them and drops duplicates in one go, in O(A log A).
+ * The graph must not be used for lookups until finalise() was called.
+ */
+struct graph_builder {
+
+    graph& g;
+
+    graph_builder(graph& gr)
+        : g(gr) { }
+
+    inline void add_seg(const seg_def& s) { g.add_seg(s); }
+    inline void add_seg(const char* name, std::size_t n, std::uint64_t len) { g.add_seg(name, n, len); }
+
+    void add_edge(const std::string& sref, std::uint32_t sbeg, std::uint32_t send,
+                  const std::string& dref, std::uint32_t dbeg, std::uint32_t dend);
+
+    // sorts, deduplicates and indexes the arcs, making the graph ready for use
+    void finalise();
 };
 
 
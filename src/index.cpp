@@ -0,0 +1,358 @@
+/* index.cpp
+ *
+ * Copyright (C) 2021  Marco van Zwetselaar <io@zwets.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "index.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "utils.h"
+
+namespace gfa {
+
+using gene_paths::raise_error;
+using gene_paths::verbose_emit;
+
+static const char MAGIC[8] = { 'G', 'P', 'I', 'N', 'D', 'E', 'X', 0 };
+static const std::uint32_t VERSION = 2;
+static const std::uint32_t BOM = 0x01020304;
+
+static_assert(sizeof(arc) == 16, "arc must be two packed u64");
+static_assert(sizeof(dna::run) == 12, "dna::run must be three packed u32");
+static_assert(sizeof(std::size_t) == 8, "index format assumes 64-bit size_t");
+
+struct header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t bom;
+    std::uint64_t n_segs, names_size, n_bits, n_excs, n_lowers;
+    std::uint64_t n_arcs, n_vtx_arcs, n_dsts, n_dst_arcs;
+};
+
+// write the zeros that pad a section of bytes length to a multiple of 8
+static void write_padding(std::ostream& os, std::size_t bytes)
+{
+    static const char zeros[8] = { 0 };
+    os.write(zeros, (8 - bytes % 8) % 8);
+}
+
+// write n elements at p to os, padded to a multiple of 8 bytes
+template <typename T>
+static void write_section(std::ostream& os, const T* p, std::size_t n)
+{
+    os.write(reinterpret_cast<const char*>(p), n * sizeof(T));
+    write_padding(os, n * sizeof(T));
+}
+
+void
+write_index(const graph& g, std::ostream& os)
+{
+    if (g.fasta)
+        raise_error("cannot index a graph that reads its sequences from FASTA");
+
+    header h;
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.bom = BOM;
+    h.n_segs = g.segs.size();
+    h.n_arcs = g.arcs.size();
+    h.n_vtx_arcs = g.vtx_arcs.size();
+    h.n_dsts = g.dsts.size();
+    h.n_dst_arcs = g.dst_arcs.size();
+
+        // collect the seg lengths and the offsets of their names and the
+        // parts of their packed data (see dna.h)
+
+    std::vector<std::uint64_t> lens, name_offs(1, 0), bits_offs(1, 0), exc_offs(1, 0), lower_offs(1, 0);
+    lens.reserve(h.n_segs);
+
+    for (const seg& s : g.segs) {
+        lens.push_back(s.len);
+        name_offs.push_back(name_offs.back() + s.name.length());
+        bits_offs.push_back(bits_offs.back() + (s.data.len + 31) / 32);
+        exc_offs.push_back(exc_offs.back() + s.data.n_excs);
+        lower_offs.push_back(lower_offs.back() + s.data.n_lowers);
+    }
+
+    h.names_size = name_offs.back();
+    h.n_bits = bits_offs.back();
+    h.n_excs = exc_offs.back();
+    h.n_lowers = lower_offs.back();
+
+        // write the header and the sections
+
+    os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+    write_section(os, lens.data(), lens.size());
+    write_section(os, name_offs.data(), name_offs.size());
+    write_section(os, bits_offs.data(), bits_offs.size());
+    write_section(os, exc_offs.data(), exc_offs.size());
+    write_section(os, lower_offs.data(), lower_offs.size());
+
+    for (const seg& s : g.segs)
+        os.write(s.name.data(), s.name.length());
+    write_padding(os, h.names_size);
+
+    for (const seg& s : g.segs)
+        os.write(reinterpret_cast<const char*>(s.data.bits), (s.data.len + 31) / 32 * sizeof(std::uint64_t));
+
+    for (const seg& s : g.segs)
+        os.write(reinterpret_cast<const char*>(s.data.excs), s.data.n_excs * sizeof(dna::run));
+    write_padding(os, h.n_excs * sizeof(dna::run));
+
+    for (const seg& s : g.segs)
+        os.write(reinterpret_cast<const char*>(s.data.lowers), s.data.n_lowers * sizeof(dna::run));
+    write_padding(os, h.n_lowers * sizeof(dna::run));
+
+    write_section(os, g.arcs.data(), g.arcs.size());
+    write_section(os, g.vtx_arcs.data(), g.vtx_arcs.size());
+    write_section(os, g.dsts.data(), g.dsts.size());
+    write_section(os, g.arc_dsts.data(), g.arc_dsts.size());
+    write_section(os, g.rev_arcs.data(), g.rev_arcs.size());
+    write_section(os, g.dst_arcs.data(), g.dst_arcs.size());
+    write_section(os, g.arc_pres.data(), g.arc_pres.size());
+
+    if (!os)
+        raise_error("failed to write index");
+}
+
+bool
+is_index(const std::string& fname)
+{
+    std::ifstream f(fname, std::ios::binary);
+    char magic[sizeof(MAGIC)];
+
+    return f.read(magic, sizeof(magic)) && !std::memcmp(magic, MAGIC, sizeof(MAGIC));
+}
+
+// reader - cursor over the mapped index, checking every section is in bounds
+struct reader {
+    const char* p;
+    const char* end;
+
+    // the next n elements of type T, advancing past them and their padding
+    template <typename T>
+    const T* section(std::size_t n) {
+        std::size_t bytes = n * sizeof(T);
+        std::size_t padded = bytes + (8 - bytes % 8) % 8;
+
+        if (n > std::size_t(end - p) / sizeof(T) || padded > std::size_t(end - p))
+            raise_error("index file is truncated or corrupt");
+
+        const T* q = reinterpret_cast<const T*>(p);
+        p += padded;
+        return q;
+    }
+
+    // assign the next n elements of type T to vector v
+    template <typename T>
+    void read(std::vector<T>& v, std::size_t n) {
+        const T* q = section<T>(n);
+        v.assign(q, q + n);
+    }
+};
+
+// true if the offsets in offs, of which there are n+1, start at 0, do not
+// decrease, and end at total
+template <typename T>
+static bool offsets_valid(const std::vector<T>& offs, std::size_t n, std::size_t total)
+{
+    if (offs.size() != n + 1 || offs.front() != 0 || offs.back() != total)
+        return false;
+
+    for (std::size_t i = 1; i < offs.size(); ++i)
+        if (offs[i-1] > offs[i])
+            return false;
+
+    return true;
+}
+
+// true if the n runs are in order, do not overlap, lie within [0,len), and
+// have a character that is a byte, so that decoding them stays in bounds
+static bool
+runs_valid(const dna::run* runs, std::size_t n, std::uint64_t len)
+{
+    std::uint64_t end = 0;
+
+    for (const dna::run* r = runs; r != runs + n; ++r) {
+        if (r->beg < end || r->beg > len || r->len > len - r->beg || r->chr > 0xFF)
+            return false;
+        end = std::uint64_t(r->beg) + r->len;
+    }
+
+    return true;
+}
+
+// true if the arcs of g and their indexes are consistent with each other and
+// the segs, so that no search or lookup goes out of bounds on them
+static bool
+arcs_valid(const graph& g)
+{
+    const std::size_t n_vtxs = g.segs.size() << 1;
+    const std::size_t n_arcs = g.arcs.size();
+    const std::size_t n_dsts = g.dsts.size();
+
+    if (!offsets_valid(g.vtx_arcs, n_vtxs, n_arcs) || !offsets_valid(g.dst_arcs, n_dsts, n_arcs))
+        return false;
+
+        // each arc is in the range of its vertex, in order, and lands on
+        // a vertex at a position within their segments
+
+    for (std::size_t v = 0; v < n_vtxs; ++v)
+        for (std::size_t i = g.vtx_arcs[v]; i < g.vtx_arcs[v+1]; ++i) {
+            const arc& a = g.arcs[i];
+            if (a.v() != v || a.w() >= n_vtxs
+                    || a.lv() > g.segs[graph::vtx_seg(a.v())].len
+                    || a.lw() > g.segs[graph::vtx_seg(a.w())].len
+                    || (i > g.vtx_arcs[v] && a.v_lv < g.arcs[i-1].v_lv))
+                return false;
+        }
+
+        // the destinations are sorted and unique, and each arc has its own
+
+    for (std::size_t d = 1; d < n_dsts; ++d)
+        if (g.dsts[d-1] >= g.dsts[d])
+            return false;
+
+    for (std::size_t i = 0; i < n_arcs; ++i)
+        if (g.arc_dsts[i] >= n_dsts || g.dsts[g.arc_dsts[i]] != g.arcs[i].w_lw
+                || (g.arc_pres[i] != graph::NO_DST && g.arc_pres[i] >= n_dsts))
+            return false;
+
+        // the reverse index groups each arc under its destination
+
+    for (std::size_t d = 0; d < n_dsts; ++d)
+        for (std::size_t j = g.dst_arcs[d]; j < g.dst_arcs[d+1]; ++j)
+            if (g.rev_arcs[j] >= n_arcs || g.arc_dsts[g.rev_arcs[j]] != d)
+                return false;
+
+    return true;
+}
+
+graph
+read_index(const std::string& fname)
+{
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd == -1)
+        raise_error("failed to open file: %s", fname.c_str());
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || std::size_t(st.st_size) < sizeof(header))
+        raise_error("not an index file: %s", fname.c_str());
+
+    std::size_t size = st.st_size;
+    void* map = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+        raise_error("failed to map file: %s", fname.c_str());
+
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    reader r = { static_cast<const char*>(map), static_cast<const char*>(map) + size };
+
+        // check the header
+
+    const header& h = *r.section<header>(1);
+
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)))
+        raise_error("not an index file: %s", fname.c_str());
+    if (h.bom != BOM)
+        raise_error("index file has wrong byte order: %s", fname.c_str());
+    if (h.version != VERSION)
+        raise_error("index file has version %u, expected %u: %s", h.version, VERSION, fname.c_str());
+
+    verbose_emit("index has %lu segs and %lu arcs", h.n_segs, h.n_arcs);
+
+        // the segs, their names, and the name lookup
+
+    graph g;
+
+    const std::uint64_t* lens = r.section<std::uint64_t>(h.n_segs);
+    const std::uint64_t* name_offs = r.section<std::uint64_t>(h.n_segs + 1);
+    const std::uint64_t* bits_offs = r.section<std::uint64_t>(h.n_segs + 1);
+    const std::uint64_t* exc_offs = r.section<std::uint64_t>(h.n_segs + 1);
+    const std::uint64_t* lower_offs = r.section<std::uint64_t>(h.n_segs + 1);
+    const char* names = r.section<char>(h.names_size);
+    const std::uint64_t* bits = r.section<std::uint64_t>(h.n_bits);
+    const dna::run* excs = r.section<dna::run>(h.n_excs);
+    const dna::run* lowers = r.section<dna::run>(h.n_lowers);
+
+    if (name_offs[h.n_segs] != h.names_size || bits_offs[h.n_segs] != h.n_bits
+            || exc_offs[h.n_segs] != h.n_excs || lower_offs[h.n_segs] != h.n_lowers)
+        raise_error("index file is corrupt: %s", fname.c_str());
+
+        // the packed data goes into the sequence arena as it is, the names
+        // each with a terminating NUL
+
+    const std::uint64_t* g_bits = g.seq_arena.copy(bits, h.n_bits);
+    const dna::run* g_excs = g.seq_arena.copy(excs, h.n_excs);
+    const dna::run* g_lowers = g.seq_arena.copy(lowers, h.n_lowers);
+
+    g.segs.resize(h.n_segs);
+    g.seg_ixs.reserve(g.segs, h.n_segs);
+    for (std::size_t i = 0; i < h.n_segs; ++i) {
+        // a segment has all its bits, or none if the graph has lengths only
+        const std::uint64_t n_bits = bits_offs[i+1] - bits_offs[i];
+        if (name_offs[i] > name_offs[i+1] || (n_bits != (lens[i] + 31) / 32 && n_bits)
+                || exc_offs[i] > exc_offs[i+1] || lower_offs[i] > lower_offs[i+1])
+            raise_error("index file is corrupt: %s", fname.c_str());
+
+        seg& s = g.segs[i];
+        s.len = lens[i];
+        s.name = name_ref(g.name_arena.copy_str(names + name_offs[i], name_offs[i+1] - name_offs[i]),
+                name_offs[i+1] - name_offs[i]);
+        s.data.len = n_bits ? lens[i] : 0;
+        s.data.bits = g_bits + bits_offs[i];
+        s.data.excs = g_excs + exc_offs[i];
+        s.data.lowers = g_lowers + lower_offs[i];
+        s.data.n_excs = exc_offs[i+1] - exc_offs[i];
+        s.data.n_lowers = lower_offs[i+1] - lower_offs[i];
+        if (!runs_valid(s.data.excs, s.data.n_excs, s.data.len)
+                || !runs_valid(s.data.lowers, s.data.n_lowers, s.data.len))
+            raise_error("index file is corrupt: %s", fname.c_str());
+        if (!g.seg_ixs.insert(g.segs, i))
+            raise_error("index file is corrupt: %s", fname.c_str());
+    }
+
+        // the arcs and their indexes, as they were in the graph
+
+    r.read(g.arcs, h.n_arcs);
+    r.read(g.vtx_arcs, h.n_vtx_arcs);
+    r.read(g.dsts, h.n_dsts);
+    r.read(g.arc_dsts, h.n_arcs);
+    r.read(g.rev_arcs, h.n_arcs);
+    r.read(g.dst_arcs, h.n_dst_arcs);
+    r.read(g.arc_pres, h.n_arcs);
+
+    munmap(map, size);
+
+    if (!arcs_valid(g))
+        raise_error("index file is corrupt: %s", fname.c_str());
+
+    return g;
+}
+
+} // namespace gfa
+
+// vim: sts=4:sw=4:ai:si:et
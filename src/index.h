@@ -0,0 +1,61 @@
+/* index.h
+ *
+ * Copyright (C) 2021  Marco van Zwetselaar <io@zwets.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef index_h_INCLUDED
+#define index_h_INCLUDED
+
+#include <string>
+#include <iostream>
+#include "graph.h"
+
+namespace gfa {
+
+/* Binary graph index
+ *
+ * Parsing a GFA (and FASTA) file and sorting and indexing its arcs takes
+ * long on large graphs.  The index file holds the finalised graph in its
+ * in-memory layout, so that loading it is a matter of mapping the file
+ * and copying its sections into place, without any parsing or sorting.
+ *
+ * The file starts with a fixed header (magic, format version, and a byte
+ * order mark), followed by the element counts of the sections, followed
+ * by the sections, each padded to a multiple of 8 bytes:
+ *
+ *   - seg lengths (u64), offsets of the names and of the bits, excs and
+ *     lowers of the packed data (see dna.h) (u64, count + 1 each); a graph
+ *     that has lengths only (see parse_lengths) has no packed data
+ *   - the concatenated names, bits (u64), excs and lowers (3 u32 each)
+ *   - arcs (two u64 each), vtx_arcs (u64), dsts (u64), arc_dsts (u32)
+ *   - rev_arcs (u32), dst_arcs (u64), arc_pres (u32)
+ *
+ * The index is not portable between machines of different byte order;
+ * reading one with a different version or byte order is an error.
+ */
+
+// write graph g to os in index format
+extern void write_index(const graph& g, std::ostream& os);
+
+// true if the file at fname is (at least in its header) an index file
+extern bool is_index(const std::string& fname);
+
+// read a graph from the index file at fname
+extern graph read_index(const std::string& fname);
+
+} // namespace gfa
+
+#endif // index_h_INCLUDED
+       // vim: sts=4:sw=4:ai:si:et
@@ -0,0 +1,60 @@
+/* parallel.h
+ *
+ * Copyright (C) 2021  Marco van Zwetselaar <io@zwets.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef parallel_h_INCLUDED
+#define parallel_h_INCLUDED
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace gene_paths {
+
+/* parallel_for - run fn(worker, i) for every i in [0, n) on n_workers threads
+ *
+ * Each worker takes the next i as soon as it is done with the previous,
+ * so uneven work spreads evenly.  The worker number in [0, n_workers)
+ * lets fn use state of its own, such as a search context per worker,
+ * that is reused for all the i that worker takes.  With one worker (or
+ * one item) no thread is started and fn runs on the calling thread.
+ */
+template <typename Fn>
+void parallel_for(std::size_t n_workers, std::size_t n, Fn fn)
+{
+    if (n_workers <= 1 || n <= 1) {
+        for (std::size_t i = 0; i < n; ++i)
+            fn(std::size_t(0), i);
+        return;
+    }
+
+    std::atomic<std::size_t> next(0);
+    std::vector<std::thread> threads;
+
+    for (std::size_t w = 0; w < n_workers && w < n; ++w)
+        threads.emplace_back([&next, &fn, n, w]() {
+            for (std::size_t i = next++; i < n; i = next++)
+                fn(w, i);
+        });
+
+    for (std::thread& t : threads)
+        t.join();
+}
+
+} // namespace gene_paths
+
+#endif // parallel_h_INCLUDED
+       // vim: sts=4:sw=4:ai:si:et
@@ -16,11 +16,16 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "graph.h"
+#include "parser.h"
 
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <cctype>
+#include <cstdlib>
+#include "graph.h"
+#include "fasta.h"
 #include "gfakluge.hpp"
 #include "utils.h"
 
@@ -34,20 +39,31 @@ using gene_paths::raise_error;
 // efficient data structure.
 
 static void
-gfak_to_graph(gfak::GFAKluge& gfak, graph& g, int reserve_segs, int reserve_arcs)
+gfak_to_graph(gfak::GFAKluge& gfak, graph& g, bool lengths_only = false)
 {
     auto n2s = gfak.get_name_to_seq();
     std::size_t n_segs = n2s.size();
 
-    verbose_emit("graph has %lu segs, reserving %lu", n_segs, n_segs + reserve_segs);
-    g.segs.reserve(n_segs + reserve_segs);
+    verbose_emit("graph has %lu segs", n_segs);
+    g.segs.reserve(n_segs);
+    g.seg_ixs.reserve(g.segs, n_segs);
+
+    graph_builder gb(g);
+
+    seg_def sd;     // reused, so that its data keeps its capacity
 
     for (auto p : n2s) {
-        seg seg;
-        seg.name = p.first;
-        seg.len = p.second.length;
-        seg.data = p.second.sequence;
-        g.add_seg(seg);
+        if (lengths_only) {
+            if (!p.second.length)
+                raise_error("no length for segment: %s", p.first.c_str());
+            gb.add_seg(p.first.data(), p.first.length(), p.second.length);
+        }
+        else {
+            sd.name = p.first;
+            sd.len = p.second.length;
+            sd.data.assign(p.second.sequence.data(), p.second.sequence.length());
+            gb.add_seg(sd);
+        }
     }
 
     auto s2e = gfak.get_seq_to_edges();
@@ -55,7 +71,7 @@ gfak_to_graph(gfak::GFAKluge& gfak, graph& g, int reserve_segs, int reserve_arcs
     for (auto p : n2s)
         n_edge += s2e[p.first].size();
 
-    std::size_t n_arcs = 8 * n_edge + reserve_arcs;
+    std::size_t n_arcs = 8 * n_edge;
     verbose_emit("graph has %lu edges, reserving %lu arcs", n_edge, n_arcs);
     g.arcs.reserve(n_arcs);
 
@@ -64,74 +80,348 @@ gfak_to_graph(gfak::GFAKluge& gfak, graph& g, int reserve_segs, int reserve_arcs
         for (auto e = edges.cbegin(); e != edges.cend(); ++e) {
             std::string sname = e->source_name + (e->source_orientation_forward ? '+' : '-');
             std::string dname = e->sink_name + (e->sink_orientation_forward ? '+' : '-');
-            g.add_edge(
+            gb.add_edge(
                     sname, e->source_begin, e->source_end,
                     dname, e->sink_begin, e->sink_end);
         }
     }
 
+    gb.finalise();
+
     verbose_emit("actual arc count %lu", g.arcs.size());
 }
 
 static void
-add_fasta_to_gfak(gfak::GFAKluge& gfak, std::istream& fasta)
+add_fasta_to_gfak(gfak::GFAKluge& gfak, fasta_reader& fasta)
 {
-    std::string line;
     std::string seqid;
     std::string data;
 
-    while (line.empty() && std::getline(fasta, line))
-        /* be lenient about empty lines at start */;
+    while (fasta.next(seqid)) {
+        data.clear();
+        fasta.read_seq([&data](const char* p, std::size_t n) { data.append(p, n); });
+        gfak.set_sequence_data(seqid, data);
+    }
+}
 
-    while (!line.empty()) {
+// The native parser reads the GFA line by line and moves the segments
+// straight into the graph, without building an intermediate model.  As
+// GFA does not require segments to precede the edges that reference them,
+// edges are held back in a compact list until all segments are in.
+//
+// GFA1 L lines are converted to edges that join the end of the source to
+// the start of the sink vertex, ignoring the overlap in the CIGAR, as the
+// GFAKluge conversion does, so that both parsers produce the same graph.
+// Other lines (C, P, W and GFA2 F, G, O, U) have no bearing on the graph
+// and are skipped.
 
-        if (line[0] != '>')
-            raise_error("invalid FASTA header: %s", line.c_str());
+namespace {
 
-        data.clear();
+// marks a segment length that is yet to come from the FASTA
+const std::uint64_t NO_LEN = std::uint64_t(-1);
+
+struct edge_rec {
+    std::string sref;           // source name with orientation sign
+    std::string dref;           // sink name with orientation sign
+    std::uint32_t sbeg, send;   // overlap on source, set at its end if link
+    std::uint32_t dbeg, dend;   // overlap on sink
+    bool link;                  // true if from a GFA1 L line
+};
+
+} // namespace
+
+// splits line on tabs into toks, reusing their storage, returns the count
+static std::size_t
+split_tabs(const std::string& line, std::vector<std::string>& toks)
+{
+    std::size_t n = 0, b = 0, e = 0, len = line.length();
+
+    if (len && line[len-1] == '\r')
+        --len;
+
+    do {
+        e = line.find('\t', b);
+        if (e == std::string::npos || e > len)
+            e = len;
+        if (n == toks.size())
+            toks.emplace_back();
+        toks[n++].assign(line, b, e - b);
+        b = e + 1;
+    } while (e != len);
+
+    return n;
+}
+
+// parses a non-negative number, allowing a trailing '$' on positions
+static std::uint64_t
+parse_num(const std::string& s, bool is_pos = false)
+{
+    const char *p = s.c_str();
+    char *end;
+
+    std::uint64_t v = std::strtoull(p, &end, 10);
+
+    if (end == p || !std::isdigit(static_cast<unsigned char>(*p)) || (*end && !(is_pos && *end == '$' && !end[1])))
+        raise_error("invalid number in GFA: %s", p);
+
+    return v;
+}
+
+static void
+native_parse_gfa(std::istream& file, graph& g, std::vector<edge_rec>& edges, bool lengths_only = false)
+{
+    std::string line;
+    std::vector<std::string> toks;
+    bool gfa2 = false;
+    dna data;       // reused for packing each sequence into the graph
+
+    while (std::getline(file, line)) {
+
+        if (line.empty())
+            continue;
+
+        std::size_t n = split_tabs(line, toks);
+
+        switch (line[0]) {
+
+            case 'H':
+                for (std::size_t i = 1; i < n; ++i)
+                    if (toks[i].compare(0, 5, "VN:Z:") == 0 && toks[i][5] == '2')
+                        gfa2 = true;
+                break;
+
+            case 'S': {
+                if (n < 3)
+                    raise_error("invalid S line in GFA: %s", line.c_str());
+
+                std::uint64_t len;
+                std::size_t tag_ix;
+                const std::string* seq;
+                if (n >= 4 && (gfa2 || std::isdigit(static_cast<unsigned char>(toks[2][0])))) { // S name len seq
+                    len = parse_num(toks[2]);
+                    seq = &toks[3];
+                    tag_ix = 4;
+                }
+                else {                                              // S name seq
+                    seq = &toks[2];
+                    len = *seq == "*" ? NO_LEN : seq->length();
+                    tag_ix = 3;
+                }
+
+                for (std::size_t i = tag_ix; len == NO_LEN && i < n; ++i)
+                    if (toks[i].compare(0, 5, "LN:i:") == 0)
+                        len = parse_num(toks[i].substr(5));
+
+                // the data is not checked here, as it may come from FASTA
+                std::size_t seg_ix = g.add_seg(toks[1].data(), toks[1].length(), len);
+
+                if (*seq != "*" && !lengths_only) {
+                    data.assign(seq->data(), seq->length());
+                    g.set_data(seg_ix, data);
+                }
+                break;
+            }
+
+            case 'L': { // L sname sori dname dori cigar
+                if (n < 5)
+                    raise_error("invalid L line in GFA: %s", line.c_str());
+
+                edge_rec e;
+                e.sref = toks[1] + toks[2];
+                e.dref = toks[3] + toks[4];
+                e.sbeg = e.send = 0;
+                e.dbeg = e.dend = 0;
+                e.link = true;
+                edges.push_back(std::move(e));
+                break;
+            }
 
-        std::string::const_iterator p = line.cbegin() + 1;
-        while (p != line.cend() && !std::isspace(*p)) ++p;
-        seqid = std::string(line, 1, p - line.cbegin() - 1);
+            case 'E': { // E id sref dref sbeg send dbeg dend alignment
+                if (n < 8)
+                    raise_error("invalid E line in GFA: %s", line.c_str());
 
-        while (std::getline(fasta, line)) {
-            if (line.empty())
-                continue;
-            if (line[0] == '>')
+                edge_rec e;
+                e.sref.swap(toks[2]);
+                e.dref.swap(toks[3]);
+                e.sbeg = parse_num(toks[4], true);
+                e.send = parse_num(toks[5], true);
+                e.dbeg = parse_num(toks[6], true);
+                e.dend = parse_num(toks[7], true);
+                e.link = false;
+                edges.push_back(std::move(e));
+                break;
+            }
+
+            default:
                 break;
-            data.append(line);
-            line.clear();
         }
+    }
 
-        gfak.set_sequence_data(seqid, data);
+    if (file.bad())
+        raise_error("failed to read GFA");
+}
+
+// reads the FASTA records of segments in g and packs their sequence from
+// the read buffer straight into the (reused) packed dna, which set_data
+// then copies into the graph's sequence arena
+static void
+native_add_fasta(graph& g, fasta_reader& fasta)
+{
+    std::string id;
+    dna packed;
+
+    while (fasta.next(id)) {
+
+        std::size_t seg_ix = g.find_seg_ix(id);
+        if (seg_ix == std::size_t(-1))
+            continue;
+
+        packed.assign(0, 0);
+        fasta.read_seq([&packed](const char* p, std::size_t n) { packed.append(p, n); });
+        g.set_data(seg_ix, packed);
+    }
+}
+
+// reads the records in the .fai of the FASTA file at fname and points the
+// segments in g at theirs, leaving their sequence in the file
+static void
+native_add_fai(graph& g, const std::string& fname)
+{
+    g.fasta.reset(new fasta_index(fname));
+
+    std::string id;
+    fasta_index::rec r;
+
+    while (g.fasta->next(id, r)) {
+        std::size_t seg_ix = g.find_seg_ix(id);
+        if (seg_ix != std::size_t(-1))
+            g.set_fai(seg_ix, r);
+    }
+}
+
+static void
+native_finish(graph& g, std::vector<edge_rec>& edges, bool lengths_only = false)
+{
+    for (seg& s : g.segs) {
+        if (s.len == NO_LEN) {
+            if (!s.data_len())
+                raise_error("no length or sequence for segment: %s", s.name.c_str());
+            s.len = s.data_len();
+        }
+        else if (s.len != s.data_len() && !lengths_only)
+            raise_error("segment length in GFA (%lu) differs from FASTA (%lu) for seqid %s", s.len, s.data_len(), s.name.c_str());
     }
+
+    verbose_emit("graph has %lu segs", g.segs.size());
+
+    std::size_t n_arcs = 8 * edges.size();
+    verbose_emit("graph has %lu edges, reserving %lu arcs", edges.size(), n_arcs);
+    g.arcs.reserve(n_arcs);
+
+    graph_builder gb(g);
+
+    for (edge_rec& e : edges) {
+        if (e.link) // the sink abuts the end of the source vertex
+            e.sbeg = e.send = g.segs[g.get_seg_ix(e.sref.data(), e.sref.length() - 1)].len;
+        gb.add_edge(e.sref, e.sbeg, e.send, e.dref, e.dbeg, e.dend);
+    }
+
+    gb.finalise();
+
+    verbose_emit("actual arc count %lu", g.arcs.size());
 }
 
 graph
-parse(std::istream& file, int res_segs, int res_arcs)
+parse(std::istream& file, parser_t parser)
+{
+    graph g;
+
+    if (parser == NATIVE) {
+        std::vector<edge_rec> edges;
+        native_parse_gfa(file, g, edges);
+        native_finish(g, edges);
+    }
+    else {
+        gfak::GFAKluge gfak;
+
+        if (!gfak.parse_gfa_file(file))
+            raise_error("failed to parse GFA");
+
+        gfak_to_graph(gfak, g);
+    }
+
+    return g;
+}
+
+static graph
+parse(std::istream& gfa, fasta_reader& fasta, parser_t parser)
 {
-    gfak::GFAKluge gfak;
     graph g;
 
-    if (!gfak.parse_gfa_file(file))
-        raise_error("failed to parse GFA");
+    if (parser == NATIVE) {
+        std::vector<edge_rec> edges;
+        native_parse_gfa(gfa, g, edges);
+        native_add_fasta(g, fasta);
+        native_finish(g, edges);
+    }
+    else {
+        gfak::GFAKluge gfak;
+
+        if (!gfak.parse_gfa_file(gfa))
+            raise_error("failed to parse GFA");
 
-    gfak_to_graph(gfak, g, res_segs, res_arcs);
+        add_fasta_to_gfak(gfak, fasta);
+        gfak_to_graph(gfak, g);
+    }
 
     return g;
 }
 
 graph
-parse(std::istream& gfa, std::istream& fasta, int res_segs, int res_arcs)
+parse(std::istream& gfa, std::istream& fasta, parser_t parser)
+{
+    fasta_reader r(fasta);
+    return parse(gfa, r, parser);
+}
+
+graph
+parse(std::istream& gfa, const std::string& fasta_fname, parser_t parser)
+{
+    fasta_reader r(fasta_fname);
+    return parse(gfa, r, parser);
+}
+
+graph
+parse_lengths(std::istream& file, parser_t parser)
 {
-    gfak::GFAKluge gfak;
     graph g;
 
-    if (!gfak.parse_gfa_file(gfa))
-        raise_error("failed to parse GFA");
+    if (parser == NATIVE) {
+        std::vector<edge_rec> edges;
+        native_parse_gfa(file, g, edges, true);
+        native_finish(g, edges, true);
+    }
+    else {
+        gfak::GFAKluge gfak;
+
+        if (!gfak.parse_gfa_file(file))
+            raise_error("failed to parse GFA");
+
+        gfak_to_graph(gfak, g, true);
+    }
+
+    return g;
+}
+
+graph
+parse_lazy(std::istream& gfa, const std::string& fasta_fname)
+{
+    graph g;
+    std::vector<edge_rec> edges;
 
-    add_fasta_to_gfak(gfak, fasta);
-    gfak_to_graph(gfak, g, res_segs, res_arcs);
+    native_parse_gfa(gfa, g, edges);
+    native_add_fai(g, fasta_fname);
+    native_finish(g, edges);
 
     return g;
 }
@@ -19,17 +19,31 @@
 #define parser_h_INCLUDED
 
 #include <iostream>
+#include <string>
 #include "graph.h"
 
 namespace gfa {
 
+// the parser to use: GFAKLUGE builds the complete GFAKluge model before
+// converting it to a graph, NATIVE streams the GFA directly into the graph
+enum parser_t { GFAKLUGE, NATIVE };
+
 // parse a GFA file with embedded sequences into a gfa::graph
-// reserving extra room for spare_segs and spare_arcs
-extern graph parse(std::istream& gfa, int spare_segs = 0, int spare_arcs = 0);
+extern graph parse(std::istream& gfa, parser_t = GFAKLUGE);
 
 // parse a GFA file with sequences in a FASTA file into a gfa::graph
-// reserving extra room for spare_segs and spare_arcs
-extern graph parse(std::istream& gfa, std::istream& fna, int spare_segs = 0, int spare_arcs = 0);
+extern graph parse(std::istream& gfa, std::istream& fna, parser_t = GFAKLUGE);
+
+// as above, reading the FASTA from the file at fna_fname, which may be gzipped
+extern graph parse(std::istream& gfa, const std::string& fna_fname, parser_t = GFAKLUGE);
+
+// parse a GFA file into a gfa::graph whose segments have their lengths but no
+// sequence, which is all that is needed to search paths and write their routes
+extern graph parse_lengths(std::istream& gfa, parser_t = GFAKLUGE);
+
+// parse a GFA file with the NATIVE parser, leaving the sequences in the FASTA
+// file at fna_fname, which must have a .fai index, to be read when written
+extern graph parse_lazy(std::istream& gfa, const std::string& fna_fname);
 
 } // namespace gfa
 
@@ -19,6 +19,8 @@
 #include "paths.h"
 
 #include <vector>
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 #include <ostream>
 #include "utils.h"
@@ -29,84 +31,109 @@ using gene_paths::raise_error;
 using gene_paths::verbose_emit;
 
 std::size_t
-paths::length(const path_arc& tip) const
+paths::collect_rides(const path_arc& tip) const
 {
-    // recursive is nicer, but iterate friendlier
-    //return p.pre_ix ? ride_len(p) + length(path_arcs.at(p.pre_ix)) : 0;
-
-    std::size_t len = 0L;
     const path_arc* p = &tip;
 
+    rides.clear();
     while (p->pre_ix) {
-        len += ride_len(*p);
+        rides.push_back(p);
         p = &path_arcs.at(p->pre_ix);
     }
 
-    return len;
+    std::reverse(rides.begin(), rides.end());
+    return tip.len;
 }
 
 std::ostream&
-paths::write_seq(std::ostream& os, const path_arc& p) const
+paths::write_seq(std::ostream& os, const path_arc& p, std::size_t width) const
 {
-    if (p.pre_ix) // unless we are the start arc
-    {
-            // recurse over the pre-path
+    const std::size_t len = collect_rides(p);
+    const std::size_t n_nl = width && len ? (len - 1) / width : 0;
+
+        // decode the rides into the tail of buf, leaving room up front
+        // for the newlines, each ride is on v from pp.dst to p.src
+
+    buf.resize(len + n_nl);
+    char* out = &buf[0] + n_nl;
 
-        const path_arc& pp = path_arcs.at(p.pre_ix);
-        write_seq(os, pp);
+    for (const path_arc* q : rides) {
+        const path_arc& pp = path_arcs[q->pre_ix];
+        const std::uint64_t v = pp.dst_v(); // same as q->src_v()
+        const std::size_t s_ix = graph::vtx_seg(v);
+        const std::uint64_t b = pp.dst_lv(), e = q->src_lv();
 
-            // write the seq of the ride, is v from pp.dst to p.src
+        const bool ok = is_xseg(s_ix)
+            ? get_xseg(s_ix).decode_vtx(out, graph::is_neg(v), b, e)
+            : g.segs[s_ix].decode_vtx(out, graph::is_neg(v), b, e);
+
+        if (!ok) {  // the FASTA file could not be read, leave it to the caller
+            os.setstate(std::ios::failbit);
+            return os;
+        }
 
-        std::uint64_t v = pp.dst_v(); // same as p.src_v()
-        g.get_seg(graph::vtx_seg(v))
-            .write_vtx(os, graph::is_neg(v), pp.dst_lv(), p.src_lv());
+        out += e - b;
     }
 
-    return os;
+        // wrap in place by moving lines down, line i ends up at i*(width+1)
+        // which is never past where it is now, at n_nl + i*width
+
+    for (std::size_t i = 0; i < n_nl; ++i) {
+        std::memmove(&buf[i * (width + 1)], &buf[n_nl + i * width], width);
+        buf[i * (width + 1) + width] = '\n';
+    }
+
+    return os.write(buf.data(), buf.size());
 }
 
 std::string
-paths::sequence(const path_arc& p) const
+paths::sequence(const path_arc& p, std::size_t width) const
 {
     std::stringstream ss;
-    write_seq(ss, p);
+    write_seq(ss, p, width);
     return ss.str();
 }
 
 std::ostream&
 paths::write_route(std::ostream& os, const path_arc& p) const
 {
-    if (p.pre_ix) { // unless we are the start arc
-
-            // recurse into the pre-path (const to inline)
+    collect_rides(p);
+    buf.clear();
 
-        const path_arc& pp = path_arcs.at(p.pre_ix);
-        write_route(os, pp);
+    for (const path_arc* q : rides) {
 
-            // append the seg name of final ride on v
+            // append the seg name of the ride on v
 
-        const std::uint64_t v = p.src_v();
-        const seg& s = g.get_seg(graph::vtx_seg(v));
+        const path_arc& pp = path_arcs[q->pre_ix];
+        const std::uint64_t v = q->src_v();
+        const std::size_t s_ix = graph::vtx_seg(v);
+        const std::uint64_t len = is_xseg(s_ix) ? get_xseg(s_ix).len : g.segs[s_ix].len;
 
-        if (pp.pre_ix) os << ' ';
-        os << s.name;
+        if (pp.pre_ix) buf += ' ';
+        if (is_xseg(s_ix))
+            buf += get_xseg(s_ix).name;
+        else
+            buf.append(g.segs[s_ix].name.data(), g.segs[s_ix].name.length());
 
             // append section unless v was traversed all the way
 
-        const std::uint64_t b = pp.dst_lv(), e = p.src_lv();
+        const std::uint64_t b = pp.dst_lv(), e = q->src_lv();
 
-        if (b != 0 || e != s.len) {
-            os << ':' << (graph::is_pos(v) ? b : s.len-e);
-            if (b != e)
-                os << ':' << (graph::is_pos(v) ? e : s.len-b);
+        if (b != 0 || e != len) {
+            buf += ':';
+            buf += std::to_string(graph::is_pos(v) ? b : len-e);
+            if (b != e) {
+                buf += ':';
+                buf += std::to_string(graph::is_pos(v) ? e : len-b);
+            }
         }
 
             // append orientation of v
 
-        os << (graph::is_pos(v) ? '+' : '-');
+        buf += graph::is_pos(v) ? '+' : '-';
     }
 
-    return os;
+    return os.write(buf.data(), buf.size());
 }
 
 std::string
@@ -58,6 +58,7 @@ namespace gfa {
 struct path_arc {
     std::size_t pre_ix;     // index of preceding path in paths or 0
     const arc* p_arc;       // pointer to the arc extending that path
+    std::size_t len;        // length of the path, kept by extend and repoint
 
         // convenience selectors of the src (v) and dst (w) fields
 
@@ -80,19 +81,34 @@ struct path_arc {
  *
  * The "null" path at path_ix 0 signifies the start of a path.  Therefore
  * to create a new path starting with some arc* pa using extend(0, pa).
+ *
+ * Each path_arc carries the length of its path, so that length() needs
+ * not walk back to the start.  For this to hold, a path_arc must only be
+ * changed through repoint(), and only while no other path extends it.
  */
 struct paths {
 
     const graph& g;
     std::vector<path_arc> path_arcs;
 
+    // the virtual segments numbered after those in g (see targets.h)
+    std::vector<const seg_view*> xsegs;
+
+    // scratch space for writing paths, reused across calls
+    mutable std::vector<const path_arc*> rides;
+    mutable std::string buf;
+
     paths(const graph& gr)
         : g(gr) {
-        path_arcs.push_back( {0,0} /* the 'null' path_arc at path_ix 0 */ );
+        path_arcs.push_back( {0,0,0} /* the 'null' path_arc at path_ix 0 */ );
     }
 
     // resets to empty
-    inline void clear() { path_arcs.clear(); path_arcs.push_back({0,0}); }
+    inline void clear() { path_arcs.clear(); path_arcs.push_back({0,0,0}); }
+
+    // whether seg_ix is a virtual segment, and if so the segment it is
+    inline bool is_xseg(std::size_t seg_ix) const { return seg_ix >= g.segs.size(); }
+    inline const seg_view& get_xseg(std::size_t seg_ix) const { return *xsegs.at(seg_ix - g.segs.size()); }
 
     // selector for the path_arc at p_ix, just forwards
     inline const path_arc& at(std::size_t ix) const { return path_arcs.at(ix); }
@@ -104,25 +120,49 @@ struct paths {
         if (path_ix && p_arc->v() != path_arcs.at(path_ix).p_arc->w() )
             raise_error("programmer error: invalid path extension");
 #endif
-        path_arcs.push_back({ path_ix, p_arc });
+        path_arcs.push_back({ path_ix, p_arc, len_via(path_ix, p_arc) });
         return path_arcs.size() - 1;
     }
 
+    // drops the paths from index n on, so that the paths before remain
+    inline void truncate(std::size_t n) { path_arcs.resize(n); }
+
+    // changes the path at p_ix to extend path_ix with p_arc instead, which
+    // is only valid while no path extends the one at p_ix
+    inline void repoint(std::size_t p_ix, std::size_t path_ix, const arc *p_arc) {
+        path_arc& p = path_arcs.at(p_ix);
+        p.pre_ix = path_ix;
+        p.p_arc = p_arc;
+        p.len = len_via(path_ix, p_arc);
+    }
+
     // returns the length of the 'ride' from previous arc to current arc
     inline std::size_t ride_len(const path_arc& p) const {
         return p.pre_ix ? p.p_arc->v_lv - path_arcs.at(p.pre_ix).p_arc->w_lw : 0;
     }
 
     // return the length of the path
-    std::size_t length(const path_arc& p) const;
+    inline std::size_t length(const path_arc& p) const { return p.len; }
 
     // write the path route for p to an ostream or string
     std::ostream& write_route(std::ostream& os, const path_arc& p) const;
     std::string route(const path_arc& p) const;
 
-    // write the path sequence for p to an ostream
-    std::ostream& write_seq(std::ostream& os, const path_arc& p) const;
-    std::string sequence(const path_arc& p) const;
+    // write the path sequence for p to an ostream, in lines of width if not 0,
+    // or set failbit on it (writing nothing) if the FASTA file cannot be read
+    std::ostream& write_seq(std::ostream& os, const path_arc& p, std::size_t width = 0) const;
+    std::string sequence(const path_arc& p, std::size_t width = 0) const;
+
+    private:
+        // the length of the path that extends path_ix with p_arc
+        inline std::size_t len_via(std::size_t path_ix, const arc* p_arc) const {
+            const path_arc& pp = path_arcs[path_ix];
+            return path_ix ? pp.len + (p_arc->v_lv - pp.p_arc->w_lw) : 0;
+        }
+
+        // collects the path_arcs from the start of the path to p in rides,
+        // and returns its length
+        std::size_t collect_rides(const path_arc& p) const;
 };
 
 
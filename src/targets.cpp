@@ -20,6 +20,7 @@
 
 #include <vector>
 #include <string>
+#include <sstream>
 #include <regex>
 #include "utils.h"
 
@@ -34,16 +35,35 @@ static const std::uint64_t DEFAULT = std::uint64_t(-1);
 // local marker for BEG or END is '$'
 static const std::uint64_t ENDSIGN = std::uint64_t(-2);
 
+constexpr arc target::NO_ARC;
+
+// the (virtual) terminal segment shared by all targets
+static const dna TER_DATA("X");
+const seg target::TER_SEG = { 1, name_ref("__T__", 5), TER_DATA.ref() };
+const seg_view target::TER = { 1, "__T__", &TER_SEG, 0 };
+
 void
-target::set(const std::string& ref, role_t role)
+target::set(const std::string& ref, role_t r, std::size_t rn)
+{
+    std::string err;
+
+    if (!try_set(ref, r, rn, err))
+        raise_error("%s", err.c_str());
+}
+
+bool
+target::try_set(const std::string& ref, role_t r, std::size_t rn, std::string& err)
 {
         // parse the reference
 
-    std::regex re("([^:[:space:]]+)(:([[:digit:]]+|\\$)(:([[:digit:]]+|\\$))?)?(\\+|-)");
+    static const std::regex re("([^:[:space:]]+)(:([[:digit:]]+|\\$)(:([[:digit:]]+|\\$))?)?(\\+|-)");
     std::smatch m;
 
-    if (!std::regex_match(ref, m, re))
-        raise_error("invalid target syntax: %s", ref.c_str());
+    // (positions of over 18 digits would not fit, and are beyond any contig)
+    if (!std::regex_match(ref, m, re) || m[3].length() > 18 || m[5].length() > 18) {
+        err = "invalid target syntax: " + ref;
+        return false;
+    }
 
     std::string ctg = m[1].str();
 
@@ -57,39 +77,41 @@ target::set(const std::string& ref, role_t role)
 
     verbose_emit("parsed target: %s:%ld:%ld%c", ctg.c_str(), beg, end, neg ? '-' : '+');
 
-        // locate or create the terminator
-
-    static const std::string TER("__T__");
-
-    std::size_t ter_ix = g.find_seg_ix(TER);
-
-    if (ter_ix == std::uint64_t(-1)) {
-        g.add_seg( { 1, TER, "X" } );
-        ter_ix = g.get_seg_ix(TER);
-
-        verbose_emit("added terminal segment %lu: %s", ter_ix, TER.c_str());
-    }
-    else {
-        verbose_emit("terminal segment %lu: %s", ter_ix, TER.c_str());
-    }
-
         // locate the referenced contig in graph
 
     std::size_t ref_ix = g.find_seg_ix(ctg);
-    if (ref_ix == std::uint64_t(-1))
-        raise_error("contig not in graph: %s", ctg.c_str());
+    if (ref_ix == std::uint64_t(-1)) {
+        err = "contig not in graph: " + ctg;
+        return false;
+    }
 
     const seg& ref_seg = g.get_seg(ref_ix);
     beg = beg == DEFAULT ? 0 : beg == ENDSIGN ? ref_seg.len : beg;
     end = end == DEFAULT || end == ENDSIGN ? ref_seg.len : end;
-    if (beg > ref_seg.len)
-        raise_error("start pos %lu exceeds segment length %lu for target: %s", beg, ref_seg.len, ctg.c_str());
-    else if (beg > end)
-        raise_error("begin position beyond end position on target: %s", ctg.c_str());
+    if (beg > ref_seg.len) {
+        err = "start pos " + std::to_string(beg) + " exceeds segment length "
+            + std::to_string(ref_seg.len) + " for target: " + ctg;
+        return false;
+    }
+    else if (beg > end) {
+        err = "begin position beyond end position on target: " + ctg;
+        return false;
+    }
+    else if (end > ref_seg.len) {
+        err = "end pos " + std::to_string(end) + " exceeds segment length "
+            + std::to_string(ref_seg.len) + " for target: " + ctg;
+        return false;
+    }
 
     verbose_emit("actual target: %s:%ld:%ld%c", ctg.c_str(), beg, end, neg ? '-' : '+');
 
-        // locate or create the target segment
+        // the terminator is virtual, and numbered after the graph's segments
+
+    role = r;
+    n = r == END ? rn : 0;
+    std::size_t ter_ix = this->ter_ix();
+
+        // create the (virtual) target segment
 
     std::uint64_t seg_ix = std::uint64_t(-1);
 
@@ -97,47 +119,24 @@ target::set(const std::string& ref, role_t role)
 
         std::stringstream ss;
         ss << ctg << ':' << beg << ':' << end;
-        std::string seg_name = ss.str();
 
-        seg_ix= g.find_seg_ix(seg_name);
-        if (seg_ix == std::uint64_t(-1)) {
+        tgt_seg = { end-beg, ss.str(), &ref_seg, beg };  // a view on the + segment
+        seg_ix = this->seg_ix();
 
-            std::stringstream ss;
-            ref_seg.write_seq(ss, false, beg, end);  // Store the + segment always
-
-            g.add_seg({ end-beg, seg_name, ss.str() });
-            seg_ix = g.get_seg_ix(seg_name);
-
-            verbose_emit("added target segment %lu: %s", seg_ix, seg_name.c_str());
-        }
-        else {
-            verbose_emit("found target segment %lu: %s", seg_ix, seg_name.c_str());
-        }
+        verbose_emit("target segment %lu: %s", seg_ix, tgt_seg.name.c_str());
     }
     else {
+        tgt_seg = { 0, std::string(), 0, 0 };
         seg_ix = ref_ix;
         verbose_emit("target segment is contig %lu: %s", seg_ix, ctg.c_str());
     }
 
-        // remove existing arcs
-
-    if (ter_arc.v_lv != std::uint64_t(-1)) {
-        g.arcs.erase(g.arcs_from_v_lv(ter_arc.v_lv).first);
-    }
-
-    if (ctg_arc.v_lv != std::uint64_t(-1)) {
-        g.arcs.erase(g.arcs_from_v_lv(ctg_arc.v_lv).first);
-    }
-
         // create the new ctg_arc (from seg to ctg or ctg to seg)
 
     std::uint64_t v = 0L, w = 0L, lv = 0L, lw = 0L;
 
     if (seg_ix != ref_ix) { // there is a non-zero length target segment
 
-        if (g.arcs.size() == g.arcs.capacity())
-            raise_error("programmer error: arcs vector exhausted (cap %lu)", g.arcs.size());
-
         if (role == START) { // from seg_$ to ctg_end
             v = graph::seg_vtx(seg_ix, neg);
             w = graph::seg_vtx(ref_ix, neg);
@@ -155,9 +154,8 @@ target::set(const std::string& ref, role_t role)
         }
 
         ctg_arc = { graph::v_lv(v, lv), graph::v_lv(w, lw) };
-        g.add_arc(ctg_arc);
 
-        verbose_emit("added ctg arc %lu: %lu_%lu to %lu_%lu", g.arcs.size(), v, lv, w, lw);
+        verbose_emit("virtual ctg arc: %lu_%lu to %lu_%lu", v, lv, w, lw);
     }
     else {
         ctg_arc = NO_ARC;
@@ -165,9 +163,6 @@ target::set(const std::string& ref, role_t role)
 
         // create the new ter_arc (from terminator to either seg or ctg)
 
-    if (g.arcs.size() == g.arcs.capacity())
-        raise_error("programmer error: arcs vector exhausted (cap %lu)", g.arcs.size());
-
     if (role == START) { // from ter_0 to seg_0 or ctg_b
         v = graph::seg_vtx(ter_ix, false); // ter always pos
         w = graph::seg_vtx(seg_ix, neg);
@@ -185,9 +180,41 @@ target::set(const std::string& ref, role_t role)
     }
 
     ter_arc = { graph::v_lv(v, lv), graph::v_lv(w, lw) };
-    g.add_arc(ter_arc);
 
-    verbose_emit("added terminal arc %lu: %lu_%lu to %lu_%lu", g.arcs.size(), v, lv, w, lw);
+    verbose_emit("virtual terminal arc: %lu_%lu to %lu_%lu", v, lv, w, lw);
+
+    return true;
+}
+
+std::size_t
+target::overlay_arcs(const arc* (&as)[2]) const
+{
+    std::size_t n = 0;
+
+    if (role == START)
+        as[n++] = &ter_arc;
+
+    if (ctg_arc.v_lv != NO_ARC.v_lv)
+        as[n++] = &ctg_arc;
+
+    if (role == END)
+        as[n++] = &ter_arc;
+
+    return n;
+}
+
+const seg_view*
+target::find_seg(std::size_t ix) const
+{
+    return ix == ter_ix() ? &TER
+        : ix == seg_ix() && ctg_arc.v_lv != NO_ARC.v_lv ? &tgt_seg : 0;
+}
+
+bool
+target::same_seg(const target& t) const
+{
+    return ctg_arc.v_lv != NO_ARC.v_lv && t.ctg_arc.v_lv != NO_ARC.v_lv
+        && tgt_seg.ref == t.tgt_seg.ref && tgt_seg.beg == t.tgt_seg.beg && tgt_seg.len == t.tgt_seg.len;
 }
 
 
@@ -34,7 +34,9 @@ namespace gfa {
  *
  * In order to find a path between the start and end regions, we add a
  * segment for each to the graph, but with arcs such that they can only
- * be traversed at the start and end of the path:
+ * be traversed at the start and end of the path.  These segments and
+ * arcs are "virtual": they are held by the target, not the graph, and
+ * the search consults them as an overlay on the (unchanged) graph:
  *
  *      FROM seg     i------o           TO seg     i------x
  *       arc s_o            v          arc e_i     ^
@@ -70,35 +72,64 @@ namespace gfa {
  * When the graph has only links (non-overlapping tail-to-head edges), as
  * is the case for Unicycler, then any path to the end (or from the start)
  * will always traverse the whole contig, as its arcs are only at 0 and $.
+ *
+ * The virtual segments are numbered after the segments in the graph: ter
+ * is g.segs.size(), and the START and END target segments follow it; if
+ * several END targets are searched at once, each has its own number, but
+ * an END target on the same section as the START target shares its number,
+ * so that a path can run from one to the other within it.  As
+ * nothing is added to the graph, it can be shared between any number of
+ * targets and searches, for instance by queries running in parallel.
  */
 struct target
 {
     enum role_t { START, END };
 
     // construct a target on graph g
-    target(graph& gr)
-        : g(gr), ter_arc(NO_ARC), ctg_arc(NO_ARC) { }
+    target(const graph& gr)
+        : g(gr), role(START), n(0), tgt_seg({ 0, std::string(), 0, 0 }), ter_arc(NO_ARC), ctg_arc(NO_ARC) { }
+
+    // set the target at ref and give it START or END role, which looks up
+    // the contig but neither changes the graph nor copies its sequence;
+    // the ref must have format "CONTIG[+-][:BEG[:END]]"; END targets that
+    // are searched together must each have their own number n
+    void set(const std::string&, role_t, std::size_t n = 0);
 
-    // set the target at ref and give it START or END role
-    // the ref must have format "CONTIG[+-][:BEG[:END]]"
-    void set(const std::string&, role_t);
+    // set the target as set does, but when ref is invalid (or its contig not in
+    // the graph), return false and the reason in err, leaving the target as it was
+    bool try_set(const std::string&, role_t, std::size_t n, std::string& err);
 
     // get the arc that is start/end of the path (depending on role)
     arc get_arc() const { return ter_arc; }
 
-    // get pointer to the arc in graph.arcs (convenience method)
-    // NOTE: this invalidates as soon as you add other arcs/targets
-    inline const arc* p_arc() const {
-        return reinterpret_cast<const arc*>(
-                &*(g.arcs_from_v_lv(get_arc().v_lv).first));
-    }
+    // get pointer to the start/end arc, valid as long as the target is not set again
+    inline const arc* p_arc() const { return &ter_arc; }
+
+    // get the virtual arcs of the target in path order (ter_arc first if START, last if
+    // END) into as, and return their count (2, or 1 if the target has zero length)
+    std::size_t overlay_arcs(const arc* (&as)[2]) const;
+
+    // index of the virtual terminal segment, and of the START or n-th END target segment
+    inline std::size_t ter_ix() const { return g.segs.size(); }
+    inline std::size_t seg_ix() const { return g.segs.size() + 1 + role + n; }
+
+    // the virtual segment with index seg_ix, or null if it is not the target's
+    const seg_view* find_seg(std::size_t seg_ix) const;
+
+    // true if this and t both have a target segment, on the same section of the same contig
+    bool same_seg(const target& t) const;
 
 #ifdef NDEBUG
     private:   // implementation detail private except when debug/test
 #endif
         static constexpr arc NO_ARC = { std::uint64_t(-1), std::uint64_t(-1) };
+        static const seg TER_SEG;
+        static const seg_view TER;
 
-        graph& g;           // the graph on which target (will) sit
+        const graph& g;     // the graph on which target sits
+        role_t role;        // the role it was last set to
+        std::size_t n;      // the number it was last set with
+        seg_view tgt_seg;   // the target segment (a view on the contig), unless zero length
         arc ter_arc;        // the arc between terminal and target
         arc ctg_arc;        // the arc between target and contig
 };
@@ -17,8 +17,12 @@
  */
 
 #include <gtest/gtest.h>
+#include <fstream>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include "dijkstra.h"
+#include "parser.h"
 #include "targets.h"
 #include "utils.h"
 
@@ -26,34 +30,30 @@ using namespace gfa;
 
 namespace {
 
-static seg SEG1 = { 3, "s1", "CAT" };
-static seg SEG2 = { 4, "s2", "TAGT" };
+static seg_def SEG1 = { 3, "s1", "CAT" };
+static seg_def SEG2 = { 4, "s2", "TAGT" };
 static std::string FROM = "s1:0:1+";
 static std::string TO = "s2:2:3+";
 
 static graph simple_graph() {
     graph g;
-    g.segs.reserve(2+3);  // 2 segs plus 2 targets and the TERminal
     g.add_seg(SEG1);  // seg_ix 0
     g.add_seg(SEG2);  // seg_ix 1
-    // TER            // seg_ix 2
-    // TGT1           // seg_ix 3
-    // TGT2           // seg_ix 4
-    g.arcs.reserve(1*8 + 4);  // 1 edge, 4 arcs for targets
+    // TER            // seg_ix 2 (virtual)
+    // TGT1           // seg_ix 3 (virtual)
+    // TGT2           // seg_ix 4 (virtual)
     g.add_edge("s1+", 2, 3, "s2+", 0, 1);
     return g;
 }
 
-typedef std::pair<const arc*, const arc*> parc_pair;
-static parc_pair add_targets(graph& g) {
-
-    target t0(g);
-    t0.set(FROM, target::role_t::START);
-    target t1(g);
-    t1.set(TO, target::role_t::END);
-
-    return std::make_pair(t0.p_arc(), t1.p_arc());
-}
+// targets - the FROM and TO targets on a graph
+struct targets {
+    target from, to;
+    targets(const graph& g) : from(g), to(g) {
+        from.set(FROM, target::role_t::START);
+        to.set(TO, target::role_t::END);
+    }
+};
 
 TEST(dijkstra_test, make_graph) {
     graph g = simple_graph();
@@ -63,22 +63,21 @@ TEST(dijkstra_test, make_graph) {
 
 TEST(dijkstra_test, add_targets) {
     graph g = simple_graph();
-    parc_pair t = add_targets(g);
-    ASSERT_EQ(g.segs.size(), 2+3);
-    ASSERT_EQ(g.arcs.size(), 1*4+4);
-    ASSERT_EQ(t.first->v_lv, ((2L<<1)<<32)|0);  // TER+:0
-    ASSERT_EQ(t.first->w_lw, ((3L<<1)<<32)|0);  // to TGT1+:0
-    ASSERT_EQ(t.second->v_lv,((4L<<1)<<32)|1);  // TGT2+:$
-    ASSERT_EQ(t.second->w_lw,((2L<<1)<<32)|1);  // to TER+:1
+    targets t(g);
+    ASSERT_EQ(g.segs.size(), 2);                // graph is left as is
+    ASSERT_EQ(g.arcs.size(), 4);
+    ASSERT_EQ(t.from.p_arc()->v_lv, ((2L<<1)<<32)|0);  // TER+:0
+    ASSERT_EQ(t.from.p_arc()->w_lw, ((3L<<1)<<32)|0);  // to TGT1+:0
+    ASSERT_EQ(t.to.p_arc()->v_lv, ((4L<<1)<<32)|1);    // TGT2+:$
+    ASSERT_EQ(t.to.p_arc()->w_lw, ((2L<<1)<<32)|1);    // to TER+:1
 }
 
 TEST(dijkstra_test, dijkstra_construct) {
     graph g = simple_graph();
-    add_targets(g);
 
     dijkstra dk(g);
     ASSERT_EQ(dk.ps.path_arcs.size(), 1);       // just the null path
-    ASSERT_EQ(dk.ds.size(), 8);                 // 4 for the edge, 4 for targets
+    ASSERT_EQ(dk.ds.size(), 4);                 // 4 for the edge, none for targets
     ASSERT_EQ(dk.vs.size(), 0);                 // nothing visitable
     ASSERT_FALSE(dk.found_pix);                 // nothing found
     ASSERT_EQ(dk.found_len, 0);
@@ -86,12 +85,12 @@ TEST(dijkstra_test, dijkstra_construct) {
 
 TEST(dijkstra_test, dijkstra_restart) {
     graph g = simple_graph();
-    parc_pair t = add_targets(g);
+    targets t(g);
 
     dijkstra dk(g);
-    dk.restart(t.first);                        // restart with given start arc
+    dk.restart(&t.from);                        // restart from the given target
     ASSERT_EQ(dk.ps.path_arcs.size(), 2);       // null and the start arc
-    ASSERT_EQ(dk.ds.size(), 8);                 // same as before
+    ASSERT_EQ(dk.ds.size(), 4+2);               // 4 for the edge, 2 virtual for target
     ASSERT_EQ(dk.vs.size(), 1);                 // start node is single visitable
     ASSERT_FALSE(dk.found_pix);
     ASSERT_EQ(dk.found_len, 0);
@@ -99,10 +98,10 @@ TEST(dijkstra_test, dijkstra_restart) {
 
 TEST(dijkstra_test, pop_visit) {
     graph g = simple_graph();
-    parc_pair t = add_targets(g);
+    targets t(g);
 
     dijkstra dk(g);
-    dk.restart(t.first);
+    dk.restart(&t.from);
     ASSERT_EQ(dk.vs.size(), 1);                 // start node is single visitable
 
     dijkstra::dnode& d = dk.pop_visit();
@@ -114,7 +113,6 @@ TEST(dijkstra_test, pop_visit) {
 
 TEST(dijkstra_test, did_nay_run) {
     graph g = simple_graph();
-    add_targets(g);
     dijkstra dk(g);
 
     ASSERT_EQ(dk.found_len, 0);
@@ -125,10 +123,10 @@ TEST(dijkstra_test, did_nay_run) {
 
 TEST(dijkstra_test, shortest_path) {
     graph g = simple_graph();
-    parc_pair t = add_targets(g);
+    targets t(g);
     dijkstra dk(g);
 
-    ASSERT_TRUE(dk.shortest_path(t.first, t.second));
+    ASSERT_TRUE(dk.shortest_path(t.from, t.to));
     ASSERT_TRUE(dk.found_pix);
     ASSERT_EQ(dk.found_len, 5);
     ASSERT_EQ(dk.length(), 5);
@@ -136,49 +134,287 @@ TEST(dijkstra_test, shortest_path) {
     ASSERT_EQ(dk.sequence(), "CATAG");
 }
 
+TEST(dijkstra_test, meet_paths) {
+    graph g = simple_graph();
+    targets t(g);
+    dijkstra dk(g);
+
+    dk.meet_mid = true;
+    ASSERT_TRUE(dk.shortest_path(t.from, t.to));
+    ASSERT_EQ(dk.found_len, 5);
+    ASSERT_EQ(dk.length(), 5);
+    ASSERT_EQ(dk.route(), "s1:0:1+ s1:1:3+ s2:1:2+ s2:2:3+");   // equally short as forward
+    ASSERT_EQ(dk.sequence(), "CATAG");
+
+    t.from.set(TO, target::role_t::START);
+    t.to.set(FROM, target::role_t::END);
+    ASSERT_FALSE(dk.shortest_path(t.from, t.to));       // no path from TO to FROM
+    ASSERT_FALSE(dk.found_pix);
+}
+
+TEST(dijkstra_test, meet_paths_agree) {
+    std::ifstream gfa_file("data/with_seqs.gfa");
+    graph g = parse_lengths(gfa_file, NATIVE);
+    target from(g), to(g);
+    dijkstra fwd(g), mid(g);
+    mid.meet_mid = true;
+
+    // from the end of each contig to the start of each, on either strand,
+    // both searches find a path of the same length or neither does
+    for (const seg& s1 : g.segs)
+        for (const seg& s2 : g.segs)
+            for (const char* st : { "++", "+-", "-+", "--" }) {
+                from.set(s1.name.str() + ":$" + st[0], target::role_t::START);
+                to.set(s2.name.str() + ":0" + st[1], target::role_t::END);
+                bool found = fwd.shortest_path(from, to);
+                ASSERT_EQ(mid.shortest_path(from, to), found);
+                if (found) {
+                    ASSERT_EQ(mid.found_len, fwd.found_len);
+                }
+            }
+}
+
+TEST(dijkstra_test, same_section) {
+    graph g = simple_graph();
+    target from(g), to(g);
+    dijkstra dk(g), mid(g);
+    mid.meet_mid = true;
+
+    from.set("s2+", target::role_t::START);     // START and END share the section
+    to.set("s2+", target::role_t::END);
+    ASSERT_TRUE(dk.shortest_path(from, to));
+    ASSERT_EQ(dk.found_len, 4);
+    ASSERT_EQ(dk.route(), "s2:0:4+");
+    ASSERT_EQ(dk.sequence(), "TAGT");
+    ASSERT_TRUE(mid.shortest_path(from, to));
+    ASSERT_EQ(mid.found_len, 4);
+    ASSERT_EQ(dk.top_paths(from, to, 2), 1);
+
+    from.set("s1:1:2-", target::role_t::START);
+    to.set("s1:1:2-", target::role_t::END);
+    ASSERT_TRUE(dk.shortest_path(from, to));
+    ASSERT_EQ(dk.route(), "s1:1:2-");
+    ASSERT_EQ(dk.sequence(), "T");
+
+    from.set("s2:1:4+", target::role_t::START); // a different section is not shared,
+    to.set("s2:2:4+", target::role_t::END);     // and cannot be entered from inside START
+    ASSERT_FALSE(dk.shortest_path(from, to));
+}
+
 TEST(dijkstra_test, shortest_paths) {
     graph g = simple_graph();
-    parc_pair t = add_targets(g);
+    targets t(g);
     dijkstra dk(g);
 
-    dk.shortest_paths(t.first);
+    dk.shortest_paths(t.from);
     ASSERT_FALSE(dk.found_pix);                 // always unset when searching all paths
     ASSERT_EQ(dk.found_len, 0);
-    ASSERT_EQ(dk.ps.path_arcs.size(), 4+3);     // half of the 8 from the edge, plus the target ones
+    ASSERT_EQ(dk.ps.path_arcs.size(), 1+2+2);   // null, the FROM ones, and the two s1+ to s2+
     size_t last = dk.ps.path_arcs.size() - 1;
-    ASSERT_EQ(dk.length(last), 5);
-    ASSERT_EQ(dk.route(last), "s1:0:1+ s1:1:2+ s2:0:2+ s2:2:3+");
-    ASSERT_EQ(dk.sequence(last), "CATAG");
+    ASSERT_EQ(dk.length(last), 3);              // the TO target is not on the graph
+    ASSERT_EQ(dk.route(last), "s1:0:1+ s1:1:3+");
+    ASSERT_EQ(dk.sequence(last), "CAT");
 }
 
-TEST(dijkstra_test, furthest_path_from) {
+TEST(dijkstra_test, restart_touched) {
     graph g = simple_graph();
-    parc_pair t = add_targets(g);
+    targets t(g);
     dijkstra dk(g);
 
-    dk.furthest_path(t.first);
-    ASSERT_TRUE(dk.found_pix);
+    dk.shortest_paths(t.from);
+    ASSERT_EQ(dk.touched.size(), 1+2+2-1);      // every destination reached, less null
+    dk.restart();
+    ASSERT_TRUE(dk.touched.empty());
+    for (const auto& d : dk.ds) {
+        ASSERT_EQ(d.len, std::size_t(-1));
+        ASSERT_FALSE(d.p_ref);
+    }
+
+    ASSERT_TRUE(dk.shortest_path(t.from, t.to));   // same result on reuse
     ASSERT_EQ(dk.found_len, 5);
-    ASSERT_EQ(dk.length(), 5);
     ASSERT_EQ(dk.route(), "s1:0:1+ s1:1:2+ s2:0:2+ s2:2:3+");
-    ASSERT_EQ(dk.sequence(), "CATAG");
 }
 
-/*
-TEST(dijkstra_test, furthest_path) {
-    gene_paths::set_verbose(true);
+TEST(dijkstra_test, furthest_path_from) {
     graph g = simple_graph();
-    add_targets(g);
+    targets t(g);
     dijkstra dk(g);
 
-    dk.furthest_path();
+    dk.furthest_path(t.from);
     ASSERT_TRUE(dk.found_pix);
+    ASSERT_EQ(dk.found_len, 3);
+    ASSERT_EQ(dk.length(), 3);
+    ASSERT_EQ(dk.route(), "s1:0:1+ s1:1:3+");
+    ASSERT_EQ(dk.sequence(), "CAT");
+}
+
+TEST(dijkstra_test, top_paths_twins) {
+    graph g = simple_graph();
+    targets t(g);
+    dijkstra dk(g);
+
+    ASSERT_EQ(dk.top_paths(t.from, t.to, 3), 1);  // the other way differs only in twin arc
+    ASSERT_EQ(dk.found_pixs.size(), 1);
+    ASSERT_EQ(dk.found_pix, dk.found_pixs[0]);
     ASSERT_EQ(dk.found_len, 5);
-    ASSERT_EQ(dk.length(), 5);
     ASSERT_EQ(dk.route(), "s1:0:1+ s1:1:2+ s2:0:2+ s2:2:3+");
     ASSERT_EQ(dk.sequence(), "CATAG");
 }
-*/
+
+static graph diamond_graph() {
+    graph g;
+    g.add_seg({ 4, "a", "AAAA" });
+    g.add_seg({ 2, "b", "CC" });
+    g.add_seg({ 3, "c", "GGG" });
+    g.add_seg({ 5, "d", "TTTTT" });
+    g.add_edge("a+", 4, 4, "b+", 0, 0);         // a+ then b+ or c+, then d+
+    g.add_edge("a+", 4, 4, "c+", 0, 0);
+    g.add_edge("b+", 2, 2, "d+", 0, 0);
+    g.add_edge("c+", 3, 3, "d+", 0, 0);
+    return g;
+}
+
+TEST(dijkstra_test, top_paths) {
+    graph g = diamond_graph();
+    target from(g), to(g);
+    from.set("a:0+", target::role_t::START);
+    to.set("d:5+", target::role_t::END);
+    dijkstra dk(g);
+
+    ASSERT_EQ(dk.top_paths(from, to, 3), 2);
+    ASSERT_EQ(dk.found_len, 11);
+    ASSERT_EQ(dk.length(dk.found_pixs[0]), 11);
+    ASSERT_EQ(dk.route(dk.found_pixs[0]), "a+ b+ d+");
+    ASSERT_EQ(dk.sequence(dk.found_pixs[0]), "AAAACCTTTTT");
+    ASSERT_EQ(dk.length(dk.found_pixs[1]), 12);
+    ASSERT_EQ(dk.route(dk.found_pixs[1]), "a+ c+ d+");
+    ASSERT_EQ(dk.sequence(dk.found_pixs[1]), "AAAAGGGTTTTT");
+
+    ASSERT_EQ(dk.top_paths(from, to, 1), 1);       // just the shortest
+    ASSERT_EQ(dk.route(), "a+ b+ d+");
+
+    from.set("d:0+", target::role_t::START);
+    to.set("a:4+", target::role_t::END);
+    ASSERT_EQ(dk.top_paths(from, to, 3), 0);       // no way back
+    ASSERT_TRUE(dk.found_pixs.empty());
+    ASSERT_FALSE(dk.found_pix);
+}
+
+TEST(dijkstra_test, shortest_paths_to_ends) {
+    graph g = diamond_graph();
+    target from(g), to0(g), to1(g), to2(g);
+    from.set("a:0+", target::role_t::START);
+    to0.set("c:1:2+", target::role_t::END, 0);
+    to1.set("b:1+", target::role_t::END, 1);
+    to2.set("a:2-", target::role_t::END, 2);
+    dijkstra dk(g);
+
+    ASSERT_EQ(dk.shortest_paths(from, { &to0, &to1, &to2 }), 2);
+    ASSERT_EQ(dk.found_pixs.size(), 2);
+    ASSERT_EQ(dk.found_pixs[0], dk.path_to(1)); // in the order reached
+    ASSERT_EQ(dk.found_pixs[1], dk.path_to(0));
+    ASSERT_EQ(dk.found_pix, dk.path_to(1));
+    ASSERT_EQ(dk.found_len, 5);
+    ASSERT_TRUE(dk.path_to(0));
+    ASSERT_EQ(dk.length(dk.path_to(0)), 4+2);
+    ASSERT_EQ(dk.route(dk.path_to(0)), "a+ c:0:1+ c:1:2+");
+    ASSERT_EQ(dk.sequence(dk.path_to(0)), "AAAAGG");
+    ASSERT_EQ(dk.length(dk.path_to(1)), 4+1);
+    ASSERT_EQ(dk.route(dk.path_to(1)), "a+ b:0:1+");
+    ASSERT_FALSE(dk.path_to(2));                // no way onto a-
+
+    ASSERT_EQ(dk.shortest_paths(from, { &to0, &to1, &to2 }, 1), 1);
+    ASSERT_EQ(dk.route(), "a+ b:0:1+");         // stopped at the nearest
+    ASSERT_FALSE(dk.path_to(0));
+}
+
+TEST(dijkstra_test, max_dist) {
+    graph g = diamond_graph();
+    target from(g), to(g);
+    from.set("a:0+", target::role_t::START);
+    to.set("d:5+", target::role_t::END);
+    dijkstra dk(g);
+
+    dk.max_dist = 11;
+    ASSERT_TRUE(dk.shortest_path(from, to));
+    ASSERT_EQ(dk.found_len, 11);
+    ASSERT_EQ(dk.top_paths(from, to, 3), 1);    // the one of 12 is too long
+    ASSERT_TRUE(dk.meet_paths(from, to));
+
+    dk.max_dist = 10;
+    ASSERT_FALSE(dk.shortest_path(from, to));
+    ASSERT_EQ(dk.top_paths(from, to, 3), 0);
+    ASSERT_FALSE(dk.meet_paths(from, to));
+
+    dk.max_dist = 4;                            // the furthest within reach
+    dk.furthest_path(from);
+    ASSERT_EQ(dk.found_len, 4);
+}
+
+TEST(dijkstra_test, all_paths) {
+    graph g = diamond_graph();
+    target from(g), to(g);
+    from.set("a:0+", target::role_t::START);
+    to.set("d:5+", target::role_t::END);
+    dijkstra dk(g);
+
+    std::vector<std::string> routes;
+    auto emit = [&](std::size_t p_ix) { routes.push_back(dk.route(p_ix) + " " + std::to_string(dk.length(p_ix))); };
+
+    ASSERT_EQ(dk.all_paths(from, to, 12, emit), 2);
+    std::sort(routes.begin(), routes.end());
+    ASSERT_EQ(routes[0], "a+ b+ d+ 11");
+    ASSERT_EQ(routes[1], "a+ c+ d+ 12");
+
+    routes.clear();
+    ASSERT_EQ(dk.all_paths(from, to, 11, emit), 1);   // the longer is cut off
+    ASSERT_EQ(routes[0], "a+ b+ d+ 11");
+    ASSERT_EQ(dk.all_paths(from, to, 10, emit), 0);   // and so are both
+    ASSERT_EQ(dk.ps.path_arcs.size(), 2);              // null and start left
+
+    graph g2 = simple_graph();
+    targets t(g2);
+    dijkstra dk2(g2);
+    ASSERT_EQ(dk2.all_paths(t.from, t.to, 100, [](std::size_t) { }), 1);  // twins count once
+}
+
+TEST(dijkstra_test, furthest_path) {
+    graph g = diamond_graph();
+    target from(g);
+    dijkstra dk(g);
+
+    dk.furthest_path(from, 1);                  // from d- over b- to the arc into a-
+    ASSERT_TRUE(dk.found_pix);
+    ASSERT_EQ(dk.found_len, 7);
+    ASSERT_EQ(dk.route(), "d:0:5- d:0- b-");
+    ASSERT_EQ(dk.sequence(), "AAAAAGG");
+
+    std::size_t max_len = 0;                    // the longest from each contig
+    for (const char* ref : { "a+", "a-", "b+", "b-", "c+", "c-", "d+", "d-" }) {
+        from.set(ref, target::role_t::START);
+        dk.furthest_path(from);
+        max_len = std::max(max_len, dk.found_len);
+    }
+    ASSERT_EQ(max_len, 7);
+
+    dk.furthest_path(from, 3);                  // same on threads
+    ASSERT_EQ(dk.found_len, 7);
+    ASSERT_EQ(dk.route(), "d:0:5- d:0- b-");
+
+    graph g2 = simple_graph();
+    target from2(g2);
+    dijkstra dk2(g2);
+    dk2.furthest_path(from2, 2);
+    ASSERT_EQ(dk2.found_len, 4);                // s2 itself is longer than s1 onto s2
+    ASSERT_EQ(dk2.route(), "s2:0:4+");
+    ASSERT_EQ(dk2.sequence(), "TAGT");
+
+    graph g3;                                   // nothing to search
+    target from3(g3);
+    dijkstra dk3(g3);
+    dk3.furthest_path(from3, 2);
+    ASSERT_FALSE(dk3.found_pix);
+}
 
 } // namespace
   // vim: sts=4:sw=4:ai:si:et
@@ -0,0 +1,136 @@
+/* dna-test.cpp
+ *
+ * Copyright (C) 2021  Marco van Zwetselaar <io@zwets.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include "dna.h"
+
+using namespace gfa;
+
+namespace {
+
+// reference reverse complement, for the characters used below
+static std::string rev_comp(const std::string& s) {
+    std::string r;
+    for (auto p = s.crbegin(); p != s.crend(); ++p)
+        switch (*p) {
+            case 'A': r += 'T'; break; case 'C': r += 'G'; break;
+            case 'G': r += 'C'; break; case 'T': r += 'A'; break;
+            case 'a': r += 't'; break; case 'c': r += 'g'; break;
+            case 'g': r += 'c'; break; case 't': r += 'a'; break;
+            case 'N': r += 'N'; break; case 'n': r += 'n'; break;
+            case 'R': r += 'Y'; break; case 'y': r += 'r'; break;
+            default: r += '?';
+        }
+    return r;
+}
+
+static std::string write(const dna& d, bool rc, std::uint64_t beg, std::uint64_t end) {
+    std::ostringstream os;
+    d.write(os, rc, beg, end);
+    return os.str();
+}
+
+TEST(dna_test, empty) {
+    dna d;
+    ASSERT_TRUE(d.empty());
+    ASSERT_EQ(d.length(), 0);
+    ASSERT_EQ(d.str(), "");
+    ASSERT_EQ(write(d, true, 0, 0), "");
+}
+
+TEST(dna_test, pack_acgt) {
+    dna d("ACGTTGCA");
+    ASSERT_EQ(d.length(), 8);
+    ASSERT_EQ(d.bits.size(), 1);
+    ASSERT_EQ(d.bits[0], 0x1BE4);           // 0,1,2,3,3,2,1,0 from the low end
+    ASSERT_TRUE(d.excs.empty());
+    ASSERT_TRUE(d.lowers.empty());
+    ASSERT_EQ(d, "ACGTTGCA");
+}
+
+TEST(dna_test, exceptions_and_case) {
+    std::string s = "ACNNNGTacgtnnRyT";
+    dna d(s);
+    ASSERT_EQ(d.excs.size(), 4);            // NNN, nn, R, y
+    ASSERT_EQ(d.excs[0].beg, 2);
+    ASSERT_EQ(d.excs[0].len, 3);
+    ASSERT_EQ(d.excs[0].chr, 'N');
+    ASSERT_EQ(d.lowers.size(), 2);          // acgtnn and y
+    ASSERT_EQ(d.lowers[0].beg, 7);
+    ASSERT_EQ(d.lowers[0].len, 6);
+    ASSERT_EQ(d.str(), s);
+    ASSERT_EQ(write(d, true, 0, s.length()), rev_comp(s));
+}
+
+TEST(dna_test, sections) {
+    std::string s;
+    for (int i = 0; i < 300; ++i)
+        s += "ACGTNacgtR"[(i * 7 + i / 13) % 10];
+    dna d(s);
+
+    for (std::size_t b = 0; b < s.length(); b += 17)
+        for (std::size_t e = b; e <= s.length(); e += 23) {
+            ASSERT_EQ(d.substr(b, e - b), s.substr(b, e - b));
+            ASSERT_EQ(write(d, false, b, e), s.substr(b, e - b));
+            ASSERT_EQ(write(d, true, b, e), rev_comp(s.substr(b, e - b)));
+        }
+}
+
+TEST(dna_test, long_write) {
+    std::string s;
+    for (int i = 0; i < 100000; ++i)
+        s += "ACGTGTCA"[(i * 5 + i / 3) % 8];
+    dna d(s);
+
+    ASSERT_EQ(d.bits.size(), (s.length() + 31) / 32);
+    ASSERT_EQ(write(d, false, 0, s.length()), s);
+    ASSERT_EQ(write(d, true, 0, s.length()), rev_comp(s));
+    ASSERT_EQ(write(d, true, 5, 70000), rev_comp(s.substr(5, 70000 - 5)));
+}
+
+TEST(dna_test, other_characters) {
+    // not IUPAC, so left as they are on the minus strand, whether the
+    // sequence is unpacked or reverse complemented as read from FASTA
+    std::string s = "ACGTX-ACGT*acgtx.";
+    std::string r = ".xacgt*ACGT-XACGT";
+    dna d(s);
+
+    ASSERT_EQ(d.str(), s);
+    ASSERT_EQ(write(d, true, 0, s.length()), r);
+
+    std::string out(s.length() - 4, '\0');
+    d.decode(&out[0], 2, s.length() - 2, true);
+    ASSERT_EQ(out, r.substr(2, s.length() - 4));
+
+    std::string f = s;
+    reverse_complement(&f[0], f.length());
+    ASSERT_EQ(f, r);
+}
+
+TEST(dna_test, compare) {
+    dna d1("ACGT"), d2(std::string("ACGT")), d3("ACGA");
+    ASSERT_EQ(d1, d2);
+    ASSERT_NE(d1, d3);
+    ASSERT_EQ(d1, std::string("ACGT"));
+    ASSERT_NE(d1, "ACG");
+}
+
+} // namespace
+  // vim: sts=4:sw=4:ai:si:et
@@ -0,0 +1,187 @@
+/* fasta-test.cpp
+ *
+ * Copyright (C) 2021  Marco van Zwetselaar <io@zwets.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "fasta.h"
+
+using namespace gfa;
+
+namespace {
+
+// read all records from r into (id, sequence) pairs
+static std::vector<std::pair<std::string, std::string>> read_all(fasta_reader& r) {
+    std::vector<std::pair<std::string, std::string>> recs;
+    std::string id;
+    while (r.next(id)) {
+        std::string seq;
+        r.read_seq([&seq](const char* p, std::size_t n) { seq.append(p, n); });
+        recs.emplace_back(id, seq);
+    }
+    return recs;
+}
+
+TEST(fasta_test, records) {
+    std::istringstream s("\n>s1 some description\nACGT\nTT\n\n>s2\r\nGG\r\nCC\r\n>s3\n>s4\nA");
+    fasta_reader r(s);
+    auto recs = read_all(r);
+
+    ASSERT_EQ(recs.size(), 4);
+    ASSERT_EQ(recs[0].first, "s1");
+    ASSERT_EQ(recs[0].second, "ACGTTT");
+    ASSERT_EQ(recs[1].first, "s2");
+    ASSERT_EQ(recs[1].second, "GGCC");
+    ASSERT_EQ(recs[2].first, "s3");
+    ASSERT_EQ(recs[2].second, "");
+    ASSERT_EQ(recs[3].first, "s4");
+    ASSERT_EQ(recs[3].second, "A");
+}
+
+TEST(fasta_test, skip_records) {
+    std::istringstream s(">s1\nACGT\n>s2\nGG\n>s3\nCC\n");
+    fasta_reader r(s);
+    std::string id, seq;
+
+    ASSERT_TRUE(r.next(id));            // s1 not read
+    ASSERT_TRUE(r.next(id));
+    ASSERT_EQ(id, "s2");
+    r.read_seq([&seq](const char* p, std::size_t n) { seq.append(p, n); });
+    ASSERT_EQ(seq, "GG");
+    ASSERT_TRUE(r.next(id));            // s3 not read
+    ASSERT_FALSE(r.next(id));
+}
+
+TEST(fasta_test, across_blocks) {
+    std::string seq, fna;               // lines and ids straddle block ends
+    for (std::size_t i = 0; i < 3 * fasta_reader::BLOCK; ++i)
+        seq += "ACGTN"[i % 5];
+    for (std::size_t i = 0; i < 3; ++i)
+        fna += ">rec" + std::to_string(i) + std::string(1000 + i, 'x') + " d\n" + seq.substr(0, seq.length() - i * 777) + "\n";
+
+    std::istringstream s(fna);
+    fasta_reader r(s);
+    auto recs = read_all(r);
+
+    ASSERT_EQ(recs.size(), 3);
+    for (std::size_t i = 0; i < 3; ++i) {
+        ASSERT_EQ(recs[i].first, "rec" + std::to_string(i) + std::string(1000 + i, 'x'));
+        ASSERT_EQ(recs[i].second, seq.substr(0, seq.length() - i * 777));
+    }
+}
+
+TEST(fasta_test, gzip_and_plain) {
+    const char* data = ">s1\nACGT\nAC\n>s2\nTTT\n";
+
+    gzFile f = gzopen("fasta-test.fna.gz", "wb");
+    gzputs(f, data);
+    gzclose(f);
+    std::ofstream("fasta-test.fna") << data;
+
+    for (const char* fname : { "fasta-test.fna.gz", "fasta-test.fna" }) {
+        fasta_reader r(fname);
+        auto recs = read_all(r);
+        ASSERT_EQ(recs.size(), 2);
+        ASSERT_EQ(recs[0].second, "ACGTAC");
+        ASSERT_EQ(recs[1].first, "s2");
+        ASSERT_EQ(recs[1].second, "TTT");
+    }
+
+    std::remove("fasta-test.fna.gz");
+    std::remove("fasta-test.fna");
+}
+
+TEST(fasta_test, invalid) {
+    std::istringstream s("ACGT\n>s1\nA\n");
+    fasta_reader r(s);
+    std::string id;
+
+    ASSERT_EXIT( r.next(id);,
+            testing::ExitedWithCode(1),
+            ": error: invalid FASTA header: ACGT");
+
+    ASSERT_EXIT( fasta_reader r2("no-such-file");,
+            testing::ExitedWithCode(1),
+            ": error: failed to open file: no-such-file");
+}
+
+TEST(fasta_test, index) {
+    // a record of 10 on lines of 4, with CRLF, and one of 3 on a single line
+    std::ofstream("fasta-test.fna") << ">s1 desc\r\nACGT\r\nacgt\r\nNR\r\n>s2\nGGA\n";
+    std::ofstream("fasta-test.fna.fai") << "s1\t10\t10\t4\t6\ns2\t3\t30\t3\t4\n";
+
+    ASSERT_TRUE(fasta_index::available("fasta-test.fna"));
+    ASSERT_FALSE(fasta_index::available("no-such-file"));
+
+    fasta_index fai("fasta-test.fna");
+    std::string id;
+    fasta_index::rec r1, r2, r;
+
+    ASSERT_TRUE(fai.next(id, r1));
+    ASSERT_EQ(id, "s1");
+    ASSERT_EQ(r1.len, 10);
+    ASSERT_EQ(r1.file, &fai);
+    ASSERT_TRUE(fai.next(id, r2));
+    ASSERT_EQ(id, "s2");
+    ASSERT_FALSE(fai.next(id, r));
+
+    char out[16];
+    ASSERT_TRUE(fai.decode(r1, out, 0, 10));
+    ASSERT_EQ(std::string(out, 10), "ACGTacgtNR");
+    fai.decode(r1, out, 3, 9);
+    ASSERT_EQ(std::string(out, 6), "TacgtN");
+    fai.decode(r1, out, 3, 9, true);
+    ASSERT_EQ(std::string(out, 6), "NacgtA");
+    fai.decode(r1, out, 8, 10, true);
+    ASSERT_EQ(std::string(out, 2), "YN");
+    fai.decode(r2, out, 1, 3);
+    ASSERT_EQ(std::string(out, 2), "GA");
+
+    ASSERT_FALSE(fai.decode(r2, out, 1, 4));    // past the end of the record
+
+    r2.offset = 31;                             // does not match the file
+    ASSERT_FALSE(fai.decode(r2, out, 0, 3));
+    r2.offset = 100;                            // is past the end of it
+    ASSERT_FALSE(fai.decode(r2, out, 0, 3));
+
+    std::remove("fasta-test.fna");
+    std::remove("fasta-test.fna.fai");
+}
+
+TEST(fasta_test, invalid_index) {
+    std::ofstream("fasta-test.fna") << ">s1\nACGT\n";
+    std::ofstream("fasta-test.fna.fai") << "s1\t4\t4\t0\t1\n";
+
+    fasta_index fai("fasta-test.fna");
+    std::string id;
+    fasta_index::rec r;
+
+    ASSERT_EXIT( fai.next(id, r);,
+            testing::ExitedWithCode(1),
+            ": error: invalid line 1 in FASTA index fasta-test.fna.fai");
+
+    std::remove("fasta-test.fna");
+    std::remove("fasta-test.fna.fai");
+}
+
+} // namespace
+  // vim: sts=4:sw=4:ai:si:et
@@ -16,6 +16,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <gtest/gtest.h>
 #include "graph.h"
 
@@ -31,49 +32,104 @@ TEST(graph_test, empty_gfa) {
 
 TEST(graph_test, add_1_seg) {
     graph gfa;
-    seg s;
+    seg_def s;
     s.len = 4;
     s.data = "ACGT";
     s.name = "s1";
     gfa.add_seg(s);
     ASSERT_EQ(gfa.segs.size(), 1);
     ASSERT_EQ(gfa.seg_ixs.size(), 1);
-    ASSERT_EQ(gfa.seg_ixs[s.name], 0);
+    ASSERT_EQ(gfa.find_seg_ix(s.name), 0);
 }
 
 TEST(graph_test, add_2_seg) {
     graph gfa;
-    seg s1; s1.len = 4; s1.data = "ACGT"; s1.name = "s1";
+    seg_def s1; s1.len = 4; s1.data = "ACGT"; s1.name = "s1";
     gfa.add_seg(s1);
-    seg s2; s2.len = 5; s2.data = "GATCA"; s2.name = "s2";
+    seg_def s2; s2.len = 5; s2.data = "GATCA"; s2.name = "s2";
     gfa.add_seg(s2);
     ASSERT_EQ(gfa.segs.size(), 2);
     ASSERT_EQ(gfa.seg_ixs.size(), 2);
-    ASSERT_EQ(gfa.seg_ixs[s1.name], 0);
-    ASSERT_EQ(gfa.seg_ixs[s2.name], 1);
+    ASSERT_EQ(gfa.find_seg_ix(s1.name), 0);
+    ASSERT_EQ(gfa.find_seg_ix(s2.name), 1);
 }
 
 TEST(graph_test, add_dup_seg) {
     graph gfa;
-    seg s1; s1.len = 4; s1.data = "ACGT"; s1.name = "s1";
+    seg_def s1; s1.len = 4; s1.data = "ACGT"; s1.name = "s1";
     gfa.add_seg(s1);
     ASSERT_EXIT( gfa.add_seg(s1);,
             testing::ExitedWithCode(1), 
             ": error: duplicate segment name: s1");
 }
 
+TEST(graph_test, name_index) {
+    std::vector<std::string> names;             // numeric names, and others
+    std::vector<seg> segs;
+    names.reserve(1001);
+    auto push = [&](const std::string& n) {
+        names.push_back(n);
+        segs.push_back({ 1, name_ref(names.back().c_str(), n.length()), dna_ref() });
+    };
+
+    name_index ix;
+    for (std::size_t i = 0; i < 1000; ++i) {
+        push(i % 3 ? std::to_string(i) : "ctg_" + std::to_string(i));
+        ASSERT_TRUE(ix.insert(segs, i));
+    }
+    ASSERT_EQ(ix.size(), 1000);
+
+    for (std::size_t i = 0; i < 1000; ++i)
+        ASSERT_EQ(ix.find(segs, segs[i].name.data(), segs[i].name.length()), i);
+
+    ASSERT_EQ(ix.find(segs, "0", 1), std::size_t(-1));     // it is ctg_0
+    ASSERT_EQ(ix.find(segs, "01", 2), std::size_t(-1));    // same value as 1
+    ASSERT_EQ(ix.find(segs, "1000", 4), std::size_t(-1));
+    ASSERT_EQ(ix.find(segs, "ctg_1", 5), std::size_t(-1));
+    ASSERT_EQ(ix.find(segs, "", 0), std::size_t(-1));
+
+    push("17");                                 // a duplicate is not added
+    ASSERT_FALSE(ix.insert(segs, 1000));
+    ASSERT_EQ(ix.size(), 1000);
+    ASSERT_EQ(ix.find(segs, "17", 2), 17);
+
+    name_index ix2;                             // reserved tables find the same
+    ix2.reserve(segs, 1000);
+    for (std::size_t i = 0; i < 1000; ++i)
+        ASSERT_TRUE(ix2.insert(segs, i));
+    ASSERT_EQ(ix2.find(segs, "ctg_999", 7), 999);
+    ASSERT_EQ(ix2.find(segs, "998", 3), 998);
+}
+
+TEST(graph_test, arenas) {
+    graph g1;
+    for (std::size_t i = 0; i < 2000; ++i) {
+        std::string data(i % 100 + 1, "ACGTN"[i % 5]);
+        g1.add_seg({ data.length(), "s" + std::to_string(i), data });
+    }
+    ASSERT_EQ(g1.name_arena.n_blocks(), 1);     // not one allocation per seg
+    ASSERT_EQ(g1.seq_arena.n_blocks(), 1);
+
+    graph g2 = std::move(g1);                   // the views stay valid
+    ASSERT_EQ(g2.segs.size(), 2000);
+    ASSERT_EQ(g2.get_seg("s1234").name, "s1234");
+    ASSERT_EQ(std::string(g2.get_seg("s1234").name.c_str()), "s1234");
+    ASSERT_EQ(g2.get_seg("s1233").data, std::string(34, 'T'));
+    ASSERT_EQ(g2.get_seg("s1999").data, std::string(100, 'N'));
+}
+
 TEST(graph_test, add_len_wrong) {
     graph gfa;
-    seg s1; s1.len = 4; s1.data = "ACG"; s1.name = "s1";
+    seg_def s1; s1.len = 4; s1.data = "ACG"; s1.name = "s1";
     ASSERT_EXIT( gfa.add_seg(s1);,
             testing::ExitedWithCode(1), 
             ": error: segment length in GFA \\(4\\) differs from FASTA \\(3\\) for seqid s1");
 }
 
-static seg SEG1 = { 4, "s1", "ACGT" };
-static seg SEG2 = { 9, "s2", "TAGCATACG" };
-static seg SEG3 = { 5, "s3", "CATTA" };
-static seg SEG4 = { 8, "s4", "GCGCAATT" };
+static seg_def SEG1 = { 4, "s1", "ACGT" };
+static seg_def SEG2 = { 9, "s2", "TAGCATACG" };
+static seg_def SEG3 = { 5, "s3", "CATTA" };
+static seg_def SEG4 = { 8, "s4", "GCGCAATT" };
 
 TEST(graph_test, add_edge) {
     graph gfa;
@@ -158,6 +214,104 @@ TEST(graph_test, vtx_iter) {
     ASSERT_EQ(afv.first->w_lw, 2L<<32|0);
 }
 
+TEST(graph_test, builder) {
+    graph gfa;
+    graph_builder gb(gfa);
+    gb.add_seg(SEG1);
+    gb.add_seg(SEG2);
+    gb.add_seg(SEG3);
+    gb.add_edge("s3+", 4, 5, "s1+", 0, 1);
+    gb.add_edge("s1+", 1, 4, "s2-", 0, 4);
+    gb.add_edge("s2-", 9, 9, "s3+", 0, 0);
+    gb.add_edge("s1+", 1, 4, "s2-", 0, 4); // duplicate
+    ASSERT_EQ(gfa.arcs.size(), 3*4+2);
+    gb.finalise();
+    ASSERT_EQ(gfa.arcs.size(), 2*4+2);
+
+    graph ref;
+    ref.add_seg(SEG1);
+    ref.add_seg(SEG2);
+    ref.add_seg(SEG3);
+    ref.add_edge("s1+", 1, 4, "s2-", 0, 4);
+    ref.add_edge("s2-", 9, 9, "s3+", 0, 0);
+    ref.add_edge("s3+", 4, 5, "s1+", 0, 1);
+    ASSERT_EQ(ref.arcs.size(), gfa.arcs.size());
+
+    for (std::size_t i = 0; i < ref.arcs.size(); ++i) {
+        ASSERT_EQ(gfa.arcs[i].v_lv, ref.arcs[i].v_lv);
+        ASSERT_EQ(gfa.arcs[i].w_lw, ref.arcs[i].w_lw);
+    }
+
+    ASSERT_EQ(gfa.vtx_arcs, ref.vtx_arcs);
+}
+
+TEST(graph_test, vtx_index) {
+    graph gfa;
+    gfa.add_seg(SEG1);
+    gfa.add_seg(SEG2);
+    gfa.add_seg(SEG3);
+    ASSERT_EQ(gfa.vtx_arcs, std::vector<std::size_t>(7, 0));
+
+    gfa.add_edge("s1+", 1, 4, "s2-", 0, 4);
+    gfa.add_edge("s2-", 9, 9, "s3+", 0, 0);
+    gfa.add_edge("s3+", 4, 5, "s1+", 0, 1);
+    ASSERT_EQ(gfa.vtx_arcs, std::vector<std::size_t>({ 0, 2, 4, 6, 7, 9, 10 }));
+
+    gfa.remove_arc({ 4L<<32|4, 0L<<32|0 });  // s3+:4 -> s1+:0
+    ASSERT_EQ(gfa.vtx_arcs, std::vector<std::size_t>({ 0, 2, 4, 6, 7, 8, 9 }));
+    ASSERT_EQ(gfa.arcs_from_vtx(4).first->v_lv, 4L<<32|5);
+
+    gfa.add_arc({ 4L<<32|4, 0L<<32|0 });
+    ASSERT_EQ(gfa.vtx_arcs, std::vector<std::size_t>({ 0, 2, 4, 6, 7, 9, 10 }));
+    ASSERT_EQ(gfa.arcs_from_vtx(4).first->v_lv, 4L<<32|4);
+
+    auto r = gfa.arcs_from_v_lv(4L<<32|5);
+    ASSERT_EQ(std::distance(r.first, r.second), 1);
+    ASSERT_EQ(r.first->v_lv, 4L<<32|5);
+}
+
+
+TEST(graph_test, dst_slots) {
+    graph gfa;
+    gfa.add_seg(SEG1);
+    gfa.add_seg(SEG2);
+    gfa.add_edge("s1+", 1, 4, "s2-", 0, 4);
+    ASSERT_TRUE(std::is_sorted(gfa.dsts.begin(), gfa.dsts.end()));
+    ASSERT_EQ(gfa.arc_dsts.size(), gfa.arcs.size());
+    for (const arc& a : gfa.arcs)
+        ASSERT_EQ(gfa.dsts[gfa.arc_dst(&a)], a.w_lw);
+
+    gfa.remove_arc(gfa.arcs.front());
+    ASSERT_EQ(gfa.arc_dsts.size(), gfa.arcs.size());
+    for (const arc& a : gfa.arcs)
+        ASSERT_EQ(gfa.dsts[gfa.arc_dst(&a)], a.w_lw);
+}
+
+TEST(graph_test, rev_index) {
+    graph gfa;
+    gfa.add_seg(SEG1);
+    gfa.add_seg(SEG2);
+    gfa.add_edge("s1+", 1, 4, "s2-", 0, 4);
+    ASSERT_EQ(gfa.rev_arcs.size(), gfa.arcs.size());
+    ASSERT_EQ(gfa.dst_arcs.size(), gfa.dsts.size() + 1);
+
+    for (std::size_t d = 0; d < gfa.dsts.size(); ++d) {
+        auto r = gfa.arcs_into_dst(d);
+        ASSERT_NE(r.first, r.second);
+        for (auto p = r.first; p != r.second; ++p)
+            ASSERT_EQ(gfa.arcs[*p].w_lw, gfa.dsts[d]);
+    }
+
+    for (std::size_t i = 0; i < gfa.arcs.size(); ++i) {
+        std::uint32_t x = gfa.arc_pres[i];
+        if (x != graph::NO_DST) {
+            ASSERT_EQ(graph::vlv_v(gfa.dsts[x]), gfa.arcs[i].v());
+            ASSERT_LE(gfa.dsts[x], gfa.arcs[i].v_lv);
+            ASSERT_TRUE(x + 1 == gfa.dsts.size() || gfa.dsts[x+1] > gfa.arcs[i].v_lv);
+        }
+    }
+}
+
 
 } // namespace
   // vim: sts=4:sw=4:ai:si:et
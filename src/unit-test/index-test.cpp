@@ -0,0 +1,206 @@
+/* index-test.cpp
+ *
+ * Copyright (C) 2021  Marco van Zwetselaar <io@zwets.it>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "index.h"
+#include "parser.h"
+#include "graph.h"
+#include "utils.h"
+
+using namespace gfa;
+
+namespace {
+
+static const std::string IDX_FILE = "index-test.idx";
+
+static void write_file(const graph& g) {
+    std::ofstream f(IDX_FILE, std::ios::binary);
+    write_index(g, f);
+}
+
+TEST(index_test, round_trip) {
+
+    std::ifstream gfa_file("data/with_seqs.gfa");
+    ASSERT_TRUE(gfa_file);
+    graph g1 = parse(gfa_file);
+
+    write_file(g1);
+    ASSERT_TRUE(is_index(IDX_FILE));
+
+    graph g2 = read_index(IDX_FILE);
+    std::remove(IDX_FILE.c_str());
+
+    ASSERT_EQ(g2.segs.size(), g1.segs.size());
+    for (std::size_t i = 0; i < g1.segs.size(); ++i) {
+        ASSERT_EQ(g2.segs[i].len, g1.segs[i].len);
+        ASSERT_EQ(g2.segs[i].name, g1.segs[i].name);
+        ASSERT_EQ(g2.segs[i].data, g1.segs[i].data);
+        ASSERT_EQ(g2.find_seg_ix(g1.segs[i].name.str()), i);
+    }
+
+    ASSERT_EQ(g2.arcs.size(), g1.arcs.size());
+    for (std::size_t i = 0; i < g1.arcs.size(); ++i) {
+        ASSERT_EQ(g2.arcs[i].v_lv, g1.arcs[i].v_lv);
+        ASSERT_EQ(g2.arcs[i].w_lw, g1.arcs[i].w_lw);
+    }
+
+    ASSERT_EQ(g2.vtx_arcs, g1.vtx_arcs);
+    ASSERT_EQ(g2.dsts, g1.dsts);
+    ASSERT_EQ(g2.arc_dsts, g1.arc_dsts);
+    ASSERT_EQ(g2.rev_arcs, g1.rev_arcs);
+    ASSERT_EQ(g2.dst_arcs, g1.dst_arcs);
+    ASSERT_EQ(g2.arc_pres, g1.arc_pres);
+}
+
+TEST(index_test, lengths_only) {
+
+    std::ifstream gfa_file("data/without_seqs.gfa");
+    ASSERT_TRUE(gfa_file);
+    graph g1 = parse_lengths(gfa_file, NATIVE);
+
+    write_file(g1);
+    graph g2 = read_index(IDX_FILE);
+    std::remove(IDX_FILE.c_str());
+
+    ASSERT_FALSE(g2.has_data());
+    ASSERT_EQ(g2.segs.size(), g1.segs.size());
+    for (std::size_t i = 0; i < g1.segs.size(); ++i) {
+        ASSERT_EQ(g2.segs[i].len, g1.segs[i].len);
+        ASSERT_EQ(g2.segs[i].name, g1.segs[i].name);
+        ASSERT_TRUE(g2.segs[i].data.empty());
+    }
+
+    ASSERT_EQ(g2.arcs.size(), g1.arcs.size());
+    ASSERT_EQ(g2.arc_pres, g1.arc_pres);
+}
+
+TEST(index_test, empty_graph) {
+
+    graph g1;
+    write_file(g1);
+
+    graph g2 = read_index(IDX_FILE);
+    std::remove(IDX_FILE.c_str());
+
+    ASSERT_TRUE(g2.segs.empty());
+    ASSERT_TRUE(g2.arcs.empty());
+    ASSERT_EQ(g2.vtx_arcs, g1.vtx_arcs);
+}
+
+TEST(index_test, not_an_index) {
+
+    ASSERT_FALSE(is_index("data/with_seqs.gfa"));
+    ASSERT_FALSE(is_index("no-such-file"));
+
+    ASSERT_EXIT( read_index("data/with_seqs.gfa");,
+            testing::ExitedWithCode(1),
+            ": error: not an index file: data/with_seqs.gfa");
+}
+
+TEST(index_test, truncated) {
+
+    std::ifstream gfa_file("data/with_seqs.gfa");
+    graph g = parse(gfa_file);
+
+    std::ostringstream os;
+    write_index(g, os);
+    std::string s = os.str();
+
+    std::ofstream f(IDX_FILE, std::ios::binary);
+    f.write(s.data(), s.size() - 8);
+    f.close();
+
+    ASSERT_EXIT( read_index(IDX_FILE);,
+            testing::ExitedWithCode(1),
+            ": error: index file is truncated or corrupt");
+
+    std::remove(IDX_FILE.c_str());
+}
+
+// writes g after tamper changed it, and checks that reading it fails
+static void assert_corrupt(const std::function<void(graph&)>& tamper) {
+    std::ifstream gfa_file("data/with_seqs.gfa");
+    graph g = parse(gfa_file);
+    tamper(g);
+    write_file(g);
+
+    ASSERT_EXIT( read_index(IDX_FILE);,
+            testing::ExitedWithCode(1),
+            ": error: index file is corrupt: " + IDX_FILE);
+
+    std::remove(IDX_FILE.c_str());
+}
+
+TEST(index_test, inconsistent) {
+
+    assert_corrupt([](graph& g) { g.vtx_arcs.pop_back(); });
+    assert_corrupt([](graph& g) { g.dst_arcs.push_back(g.arcs.size()); });
+    assert_corrupt([](graph& g) { g.vtx_arcs[1] = g.arcs.size() + 1; });
+    assert_corrupt([](graph& g) { std::swap(g.dst_arcs[1], g.dst_arcs[2]); });
+    assert_corrupt([](graph& g) { g.arcs[0].w_lw = std::uint64_t(g.segs.size() << 1) << 32; });
+    assert_corrupt([](graph& g) { g.arcs[0].w_lw += g.segs[graph::vtx_seg(g.arcs[0].w())].len + 1; });
+    assert_corrupt([](graph& g) { g.arc_dsts[0] = g.dsts.size(); });
+    assert_corrupt([](graph& g) { g.arc_pres[0] = g.dsts.size(); });
+    assert_corrupt([](graph& g) { g.rev_arcs[0] = g.arcs.size(); });
+}
+
+// the runs that set_runs points a segment's data at, as the index writes them
+static std::vector<dna::run> bad_runs;
+
+// points the excs, or the lowers if lower, of segment 12 (length 140) at rs
+static void set_runs(graph& g, bool lower, std::vector<dna::run> rs) {
+    bad_runs = std::move(rs);
+    dna_ref& d = g.segs[g.find_seg_ix("12")].data;
+    (lower ? d.lowers : d.excs) = bad_runs.data();
+    (lower ? d.n_lowers : d.n_excs) = bad_runs.size();
+}
+
+TEST(index_test, bad_runs) {
+
+    assert_corrupt([](graph& g) { set_runs(g, false, { { 5, 1, 'N' }, { 2, 1, 'N' } }); });
+    assert_corrupt([](graph& g) { set_runs(g, false, { { 2, 3, 'N' }, { 4, 1, 'N' } }); });
+    assert_corrupt([](graph& g) { set_runs(g, false, { { 139, 2, 'N' } }); });
+    assert_corrupt([](graph& g) { set_runs(g, false, { { 10, 0xFFFFFFFF, 'N' } }); });
+    assert_corrupt([](graph& g) { set_runs(g, false, { { 2, 1, 0x14E } }); });
+    assert_corrupt([](graph& g) { set_runs(g, true, { { 8, 2, 0 }, { 0, 4, 0 } }); });
+    assert_corrupt([](graph& g) { set_runs(g, true, { { 141, 0, 0 } }); });
+
+    // whereas runs in order and in bounds are fine
+    std::ifstream gfa_file("data/with_seqs.gfa");
+    graph g1 = parse(gfa_file);
+    set_runs(g1, false, { { 2, 1, 'N' }, { 3, 2, 'R' }, { 138, 2, 'N' } });
+    write_file(g1);
+    graph g2 = read_index(IDX_FILE);
+    std::remove(IDX_FILE.c_str());
+    ASSERT_EQ(g2.get_seg("12").data.str(), g1.get_seg("12").data.str());
+    ASSERT_EQ(g2.get_seg("12").data.str().substr(0, 6), "TTNRRA");
+}
+
+TEST(index_test, duplicate_names) {
+
+    assert_corrupt([](graph& g) { g.segs[1].name = g.segs[0].name; });
+}
+
+} // namespace
+  // vim: sts=4:sw=4:ai:si:et
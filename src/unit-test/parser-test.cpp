@@ -19,6 +19,8 @@
 #include <gtest/gtest.h>
 #include <sstream>
 #include <fstream>
+#include <algorithm>
+#include <vector>
 #include "parser.h"
 #include "graph.h"
 #include "utils.h"
@@ -108,5 +110,209 @@ TEST(parser_test, read_gfa_and_edge) {
 
 }
 
+TEST(parser_test, native_read_gfa) {
+
+    std::ifstream gfa_file("data/with_seqs.gfa");
+    ASSERT_TRUE(gfa_file);
+
+    graph gfa = parse(gfa_file, NATIVE);
+
+    ASSERT_EQ(gfa.segs.size(), 9);
+    ASSERT_EQ(gfa.get_seg("12").len, 140);
+    ASSERT_EQ(gfa.get_seg("16").data.substr(0, 6), "AGAAAT");
+}
+
+TEST(parser_test, native_read_gfa_and_fna) {
+
+    std::ifstream gfa_file("data/without_seqs.gfa");
+    ASSERT_TRUE(gfa_file);
+
+    std::ifstream fna_file("data/seqs.fna");
+    ASSERT_TRUE(fna_file);
+
+    graph gfa = parse(gfa_file, fna_file, NATIVE);
+
+    ASSERT_EQ(gfa.segs.size(), 9);
+    ASSERT_EQ(gfa.get_seg("16").data.substr(0, 6), "AGAAAT");
+}
+
+TEST(parser_test, lazy_read_gfa_and_fna) {
+
+    std::ifstream gfa_file1("data/without_seqs.gfa");
+    std::ifstream gfa_file2("data/without_seqs.gfa");
+    std::ifstream fna_file("data/seqs.fna");
+
+    graph g1 = parse(gfa_file1, fna_file, NATIVE);
+    graph g2 = parse_lazy(gfa_file2, "data/seqs.fna");
+
+    ASSERT_EQ(g2.segs.size(), 9);
+    ASSERT_TRUE(g2.fasta);
+    ASSERT_EQ(g2.seq_arena.size(), 9 * sizeof(fasta_index::rec));
+
+    for (std::size_t i = 0; i < g1.segs.size(); ++i) {
+        const seg& s1 = g1.segs[i];
+        const seg& s2 = g2.segs[i];
+        ASSERT_TRUE(s2.fai);
+        ASSERT_EQ(s1.len, s2.len);
+
+        std::stringstream ss1, ss2;
+        s1.write_vtx(ss1, true, 3, s1.len - 2);
+        s2.write_vtx(ss2, true, 3, s2.len - 2);
+        ASSERT_EQ(ss1.str(), ss2.str());
+        ASSERT_EQ(ss2.str().length(), s2.len - 5);
+    }
+}
+
+TEST(parser_test, native_same_arcs) {
+
+    // GFA2 edges, and GFA1 links with and without overlap in their CIGAR
+    for (const char* fname : { "data/with_seqs.gfa", "data/gfa1_links.gfa" }) {
+
+        std::ifstream gfa_file1(fname);
+        std::ifstream gfa_file2(fname);
+
+        graph g1 = parse(gfa_file1);
+        graph g2 = parse(gfa_file2, NATIVE);
+
+        ASSERT_FALSE(g1.arcs.empty());
+        ASSERT_EQ(g1.arcs.size(), g2.arcs.size());
+
+        // segments are numbered differently, so compare by name and position
+        std::vector<std::string> a1, a2;
+        for (const arc& a : g1.arcs)
+            a1.push_back(g1.segs[a.v()>>1].name.str() + std::to_string(a.v()&1) + ':' + std::to_string(a.lv()) + '>' +
+                         g1.segs[a.w()>>1].name.str() + std::to_string(a.w()&1) + ':' + std::to_string(a.lw()));
+        for (const arc& a : g2.arcs)
+            a2.push_back(g2.segs[a.v()>>1].name.str() + std::to_string(a.v()&1) + ':' + std::to_string(a.lv()) + '>' +
+                         g2.segs[a.w()>>1].name.str() + std::to_string(a.w()&1) + ':' + std::to_string(a.lw()));
+        std::sort(a1.begin(), a1.end());
+        std::sort(a2.begin(), a2.end());
+
+        ASSERT_EQ(a1, a2);
+    }
+}
+
+TEST(parser_test, native_mismatch_fna) {
+
+    std::istringstream s_gfa("H\tVN:Z:2.0\nS\t1\t4\t*\n");
+    std::istringstream s_fna(">1\nACG\n");
+
+    ASSERT_EXIT( parse(s_gfa, s_fna, NATIVE);,
+            testing::ExitedWithCode(1),
+            ": error: segment length in GFA \\(4\\) differs from FASTA \\(3\\) for seqid 1");
+}
+
+TEST(parser_test, native_read_gfa1_link) {
+
+    std::istringstream s_gfa("H\tVN:Z:1.0\n"
+        "S\ts1\tACGT\n"
+        "L\ts1\t+\ts2\t-\t3M\n"
+        "S\ts2\t*\tLN:i:9\n");
+    std::istringstream s_fna(">s2\nTAGCA\nTACG\n");
+
+    graph gfa = parse(s_gfa, s_fna, NATIVE);
+    ASSERT_EQ(gfa.segs.size(), 2);
+    ASSERT_EQ(gfa.get_seg("s2").data, "TAGCATACG");
+
+    // as GFAKluge, the overlap is ignored: s1+ 4 4 s2- 0 0
+    ASSERT_EQ(gfa.arcs.size(), 2);
+    ASSERT_EQ(gfa.arcs[0].v_lv, 0L<<32 | 4);
+    ASSERT_EQ(gfa.arcs[0].w_lw, 3L<<32 | 0);
+    ASSERT_EQ(gfa.arcs[1].v_lv, 2L<<32 | 9);
+    ASSERT_EQ(gfa.arcs[1].w_lw, 1L<<32 | 0);
+}
+
+TEST(parser_test, native_read_gfa1_link_neg_pos) {
+
+    std::istringstream s_gfa("S\ts1\tACGT\n"
+        "S\ts2\t*\tLN:i:9\n"
+        "L\ts1\t-\ts2\t+\t3M\n");
+
+    graph gfa = parse_lengths(s_gfa, NATIVE);
+
+    // the start of s2+ abuts the end of s1-: s1- 4 4 s2+ 0 0
+    ASSERT_EQ(gfa.arcs.size(), 2);
+    ASSERT_EQ(gfa.arcs[0].v_lv, 1L<<32 | 4);
+    ASSERT_EQ(gfa.arcs[0].w_lw, 2L<<32 | 0);
+    ASSERT_EQ(gfa.arcs[1].v_lv, 3L<<32 | 9);
+    ASSERT_EQ(gfa.arcs[1].w_lw, 0L<<32 | 0);
+}
+
+TEST(parser_test, native_read_gfa1_link_neg_neg) {
+
+    std::istringstream s_gfa("S\ts1\tACGT\n"
+        "S\ts2\t*\tLN:i:9\n"
+        "L\ts1\t-\ts2\t-\t3M\n");
+
+    graph gfa = parse_lengths(s_gfa, NATIVE);
+
+    // the start of s2- abuts the end of s1-: s1- 4 4 s2- 0 0
+    ASSERT_EQ(gfa.arcs.size(), 2);
+    ASSERT_EQ(gfa.arcs[0].v_lv, 1L<<32 | 4);
+    ASSERT_EQ(gfa.arcs[0].w_lw, 3L<<32 | 0);
+    ASSERT_EQ(gfa.arcs[1].v_lv, 2L<<32 | 9);
+    ASSERT_EQ(gfa.arcs[1].w_lw, 0L<<32 | 0);
+}
+
+TEST(parser_test, native_read_high_byte) {
+
+    // a byte >= 0x80 where a length may be is not a digit, so is the sequence
+    std::istringstream s_gfa("S\ts1\t\xe9\xe9\tLN:i:2\n");
+
+    graph gfa = parse_lengths(s_gfa, NATIVE);
+    ASSERT_EQ(gfa.segs.size(), 1);
+    ASSERT_EQ(gfa.segs[0].len, 2);
+}
+
+TEST(parser_test, native_read_gfa1_no_length) {
+
+    std::istringstream s_gfa("S\ts1\t*\n");
+
+    ASSERT_EXIT( parse(s_gfa, NATIVE);,
+            testing::ExitedWithCode(1),
+            ": error: no length or sequence for segment: s1");
+}
+
+TEST(parser_test, read_lengths) {
+
+    for (parser_t parser : { GFAKLUGE, NATIVE }) {
+
+        std::ifstream gfa_file1("data/with_seqs.gfa");
+        std::ifstream gfa_file2("data/without_seqs.gfa");
+
+        graph g1 = parse(gfa_file1, parser);
+        graph g2 = parse_lengths(gfa_file2, parser);
+
+        ASSERT_TRUE(g1.has_data());
+        ASSERT_FALSE(g2.has_data());
+        ASSERT_EQ(g2.seq_arena.size(), 0);
+
+        ASSERT_EQ(g2.segs.size(), g1.segs.size());
+        ASSERT_EQ(g2.arcs.size(), g1.arcs.size());
+        for (const seg& s : g1.segs)
+            ASSERT_EQ(g2.get_seg(s.name.str()).len, s.len);
+    }
+}
+
+TEST(parser_test, native_read_gfa1_lengths) {
+
+    std::istringstream s_gfa("H\tVN:Z:1.0\n"
+        "S\ts1\tACGT\n"
+        "L\ts1\t+\ts2\t-\t3M\n"
+        "S\ts2\t*\tLN:i:9\n");
+
+    graph gfa = parse_lengths(s_gfa, NATIVE);
+    ASSERT_EQ(gfa.get_seg("s1").len, 4);
+    ASSERT_EQ(gfa.get_seg("s2").len, 9);
+    ASSERT_TRUE(gfa.get_seg("s1").data.empty());
+    ASSERT_EQ(gfa.arcs.size(), 2);
+
+    std::istringstream s_gfa2("S\ts1\t*\n");
+
+    ASSERT_EXIT( parse_lengths(s_gfa2, NATIVE);,
+            testing::ExitedWithCode(1),
+            ": error: no length or sequence for segment: s1");
+}
+
 } // namespace
   // vim: sts=4:sw=4:ai:si:et
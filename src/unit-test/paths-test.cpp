@@ -26,10 +26,10 @@ using namespace gfa;
 
 namespace {
 
-static seg SEG1 = { 4, "s1", "ACGT" };
-static seg SEG2 = { 9, "s2", "TAGCATACG" }; // rc: CGTATGCTA
-static seg SEG3 = { 5, "s3", "CATTA" };
-static seg SEG4 = { 8, "s4", "CTATAATT" };
+static seg_def SEG1 = { 4, "s1", "ACGT" };
+static seg_def SEG2 = { 9, "s2", "TAGCATACG" }; // rc: CGTATGCTA
+static seg_def SEG3 = { 5, "s3", "CATTA" };
+static seg_def SEG4 = { 8, "s4", "CTATAATT" };
 
 static graph make_graph() {
     graph g;
@@ -46,11 +46,10 @@ static graph make_graph() {
     return g;
 }
 
-static const arc* add_start(graph& g, std::string ref) {
+static arc start_arc(const graph& g, std::string ref) {
     target t(g);
     t.set(ref, target::role_t::START);
-    std::uint64_t ter_vlv = graph::seg_vtx(g.get_seg_ix("__T__"), false)<<32;
-    return &*g.arcs_from_v_lv(ter_vlv).first;
+    return t.get_arc();     // virtual arc from __T__, whose seg_ix is g.segs.size()
 }
 
 TEST(paths_test, empty_path) {
@@ -63,7 +62,7 @@ TEST(paths_test, empty_path) {
 
 TEST(paths_test, path_1) {
     graph g = make_graph();
-    const arc  *a = add_start(g, "s1:0+");
+    const arc sa = start_arc(g, "s1:0+"), *a = &sa;
     paths p(g);
     std::size_t i = p.extend(0, a);
     ASSERT_EQ(p.path_arcs.size(), 2);
@@ -73,7 +72,7 @@ TEST(paths_test, path_1) {
 
 TEST(paths_test, write_empty) {
     graph g = make_graph();
-    const arc  *a = add_start(g, "s1:0+");
+    const arc sa = start_arc(g, "s1:0+"), *a = &sa;
     paths p(g);
     std::size_t i = p.extend(0, a);
     ASSERT_EQ(p.path_arcs.size(), 2);
@@ -89,7 +88,7 @@ TEST(paths_test, write_empty) {
 
 TEST(paths_test, write_1) {
     graph g = make_graph();
-    const arc* a = add_start(g, "s3:2+"); // s3+ CA|TTA
+    const arc sa = start_arc(g, "s3:2+"), *a = &sa; // s3+ CA|TTA
     paths p(g);
     std::size_t i = p.extend(0, a);
     ASSERT_EQ(i, 1);
@@ -111,7 +110,7 @@ TEST(paths_test, write_1) {
 
 TEST(paths_test, write_2) {
     graph g = make_graph();
-    const arc* a = add_start(g, "s3:1+"); // s3+ C|ATTA
+    const arc sa = start_arc(g, "s3:1+"), *a = &sa; // s3+ C|ATTA
     paths p = paths(g);
     std::size_t i = p.extend(0, a);
 
@@ -156,11 +155,71 @@ TEST(paths_test, write_2) {
     ASSERT_EQ(p.length(*pa), 10);
     ASSERT_EQ(p.route(*pa), "s3:1:4+ s1:0:1+ s2:3:9-");
     ASSERT_EQ(p.sequence(*pa), "ATTACGTATG");
+    ASSERT_EQ(p.sequence(*pa, 4), "ATTA\nCGTA\nTG");
+    ASSERT_EQ(p.sequence(*pa, 5), "ATTAC\nGTATG");
+    ASSERT_EQ(p.sequence(*pa, 10), "ATTACGTATG");
 
     // find first arc away from 4+, but there is none
     auto found = g.arcs_from_v_lv(arc_it->w_lw);
     ASSERT_EQ(found.first, found.second);
 }
 
+TEST(paths_test, repoint) {
+    graph g = make_graph();
+    const arc sa1 = start_arc(g, "s3:1+"), *a1 = &sa1; // s3+ C|ATTA
+    const arc sa2 = start_arc(g, "s3:3+"), *a2 = &sa2; // s3+ CAT|TA
+    paths p = paths(g);
+    std::size_t i1 = p.extend(0, a1);
+    std::size_t i2 = p.extend(0, a2);
+
+    const arc* a = &*g.arcs_from_v_lv(graph::v_lv(graph::seg_vtx(g.get_seg_ix("s3"), false),1)).first;
+    std::size_t i = p.extend(i1, a);
+    ASSERT_EQ(p.length(p.at(i)), 3);
+
+    p.repoint(i, i2, a);
+    ASSERT_EQ(p.at(i).pre_ix, i2);
+    ASSERT_EQ(p.length(p.at(i)), 1);
+    ASSERT_EQ(p.sequence(p.at(i)), "T");
+
+    // and the paths extending it take the new length along
+    std::size_t j = p.extend(i, &*g.arcs_from_v_lv(a->w_lw).first);
+    ASSERT_EQ(p.length(p.at(j)), 2);
+    ASSERT_EQ(p.sequence(p.at(j)), "TA");
+}
+
+TEST(paths_test, write_long) {
+    graph g = make_graph();
+    const arc sa = start_arc(g, "s3:0+"), *a = &sa;
+    paths p = paths(g);
+    std::size_t i = p.extend(0, a);
+
+    // go round the cycle s3+ (CATT) s1+ (A) s2- (CGTATGCTA) many times
+    const arc* a3 = &*g.arcs_from_v_lv(graph::v_lv(graph::seg_vtx(g.get_seg_ix("s3"), false), 4)).first;
+    const arc* a1 = &*g.arcs_from_v_lv(a3->w_lw).first;
+    const arc* a2 = &*g.arcs_from_v_lv(graph::v_lv(graph::seg_vtx(g.get_seg_ix("s2"), true), 9)).first;
+    ASSERT_EQ(a2->w_lw, graph::v_lv(graph::seg_vtx(g.get_seg_ix("s3"), false), 0));
+
+    const int N = 100000;
+    for (int n = 0; n < N; ++n) {
+        i = p.extend(i, a3);
+        i = p.extend(i, a1);
+        i = p.extend(i, a2);
+    }
+
+    std::string seq;
+    for (int n = 0; n < N; ++n)
+        seq += "CATTACGTATGCTA";
+
+    const path_arc& pa = p.path_arcs.at(i);
+    ASSERT_EQ(p.length(pa), seq.length());
+    ASSERT_EQ(p.sequence(pa), seq);
+    ASSERT_EQ(p.route(pa).substr(0, 34), "s3:0:4+ s1:0:1+ s2- s3:0:4+ s1:0:1");
+
+    std::string wrapped = p.sequence(pa, 60);
+    ASSERT_EQ(wrapped.length(), seq.length() + (seq.length() - 1) / 60);
+    ASSERT_EQ(wrapped.substr(0, 61), seq.substr(0, 60) + "\n");
+    ASSERT_EQ(wrapped.substr(wrapped.length() - 20), seq.substr(seq.length() - 20));
+}
+
 } // namespace
   // vim: sts=4:sw=4:ai:si:et
@@ -17,6 +17,7 @@
  */
 
 #include <gtest/gtest.h>
+#include <sstream>
 #include "graph.h"
 #include "targets.h"
 #include "utils.h"
@@ -25,32 +26,38 @@ using namespace gfa;
 
 namespace {
 
-static seg SEG1 = { 10, "SEG1", "CATTAGTACT" };
+static seg_def SEG1 = { 10, "SEG1", "CATTAGTACT" };
 
 static graph make_graph()
 {
 //  gene_paths::set_verbose(true);
 
     graph g;
-    g.segs.reserve(1 + 3 /* two targets and a terminator */);
-    g.arcs.reserve(2 * 4 /* four for each target */);
     g.add_seg(SEG1); // 0  0  1 (seg_ix, v+, v-)
-    // ter segment   // 1  2  3
-    // target 1      // 2  4  5
-    // target 2      // 3  6  7
+    // ter segment   // 1  2  3 (virtual)
+    // START target  // 2  4  5 (virtual)
+    // END target    // 3  6  7 (virtual)
     return g;
 }
 
-// arcs will be
+// the sequence of the pos or neg vertex of a seg_view
+static std::string seq(const seg_view& s, bool neg = false, std::uint32_t b = 0, std::uint32_t e = std::uint32_t(-1))
+{
+    std::stringstream ss;
+    s.write_vtx(ss, neg, b, e == std::uint32_t(-1) ? s.len : e);
+    return ss.str();
+}
+
+// virtual arcs will be (ter_arc and ctg_arc)
 //
-// 0_b   to 4_0/2_1   SEG1+ to TGT1+/TER+ [END]
-// 1_b   to 5_0/2_1   SEG1- to TGT1-/TER+ [END]
+// 0_b   to 6_0/2_1   SEG1+ to TGT2+/TER+ [END]
+// 1_b   to 7_0/2_1   SEG1- to TGT2-/TER+ [END]
 // 2_0   to 4_0/0_0   TER+  to TGT1+/SEG1+ [START]
 // 2_0   to 5_0/1_e   TER+  to TGT1-/SEG1- [START]
 // 4_e-b to 0_e       TGT1+ to SEG1+ [START]
-// 4_e-b to 2_1       TGT1+ to TER+  [END]
 // 5_e-b to 1_L-b     TGT1- to SEG1- [START]
-// 5_e-b to 2_1       TGT1- to TER+  [END]
+// 6_e-b to 2_1       TGT2+ to TER+  [END]
+// 7_e-b to 2_1       TGT2- to TER+  [END]
 
 
 TEST(targets_test, dollar_ref1) {
@@ -61,8 +68,8 @@ TEST(targets_test, dollar_ref1) {
     ASSERT_EQ(a.v_lv, 2L<<32|0);
     ASSERT_EQ(a.w_lw, 0L<<32|10);
     // 2_0   to 0_0      TER+  to SEG1+ [START]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 2L<<32|0);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 0L<<32|10);
+    ASSERT_EQ(t.ter_arc.v_lv, 2L<<32|0);
+    ASSERT_EQ(t.ter_arc.w_lw, 0L<<32|10);
 }
 
 TEST(targets_test, dollar_ref2) {
@@ -73,8 +80,8 @@ TEST(targets_test, dollar_ref2) {
     ASSERT_EQ(a.v_lv, 2L<<32|0);
     ASSERT_EQ(a.w_lw, 0L<<32|10);
     // 2_0   to 0_0      TER+  to SEG1+ [START]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 2L<<32|0);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 0L<<32|10);
+    ASSERT_EQ(t.ter_arc.v_lv, 2L<<32|0);
+    ASSERT_EQ(t.ter_arc.w_lw, 0L<<32|10);
 }
 
 TEST(targets_test, dollar_ref3) {
@@ -85,8 +92,8 @@ TEST(targets_test, dollar_ref3) {
     ASSERT_EQ(a.v_lv, 2L<<32|0);
     ASSERT_EQ(a.w_lw, 4L<<32|0);
     // 2_0   to 4_0      TER+  to TGT1+ [START]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 2L<<32|0);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 4L<<32|0);
+    ASSERT_EQ(t.ter_arc.v_lv, 2L<<32|0);
+    ASSERT_EQ(t.ter_arc.w_lw, 4L<<32|0);
 }
 
 
@@ -98,12 +105,12 @@ TEST(targets_test, start_pos_full) {
     ASSERT_EQ(a.v_lv, 2L<<32|0);
     ASSERT_EQ(a.w_lw, 4L<<32|0);
     // 2_0   to 4_0      TER+  to TGT1+ [START]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 2L<<32|0);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 4L<<32|0);
+    ASSERT_EQ(t.ter_arc.v_lv, 2L<<32|0);
+    ASSERT_EQ(t.ter_arc.w_lw, 4L<<32|0);
     // 4_e-b to 0_e      TGT1+ to SEG1+ [START]
-    ASSERT_EQ(g.arcs.at(1).v_lv, 4L<<32|10);
-    ASSERT_EQ(g.arcs.at(1).w_lw, 0L<<32|10);
-    ASSERT_EQ(g.segs.at(2).data, "CATTAGTACT");
+    ASSERT_EQ(t.ctg_arc.v_lv, 4L<<32|10);
+    ASSERT_EQ(t.ctg_arc.w_lw, 0L<<32|10);
+    ASSERT_EQ(seq(t.tgt_seg), "CATTAGTACT");
 }
 
 TEST(targets_test, start_pos_part) {
@@ -114,12 +121,12 @@ TEST(targets_test, start_pos_part) {
     ASSERT_EQ(a.v_lv, 2L<<32|0);
     ASSERT_EQ(a.w_lw, 4L<<32|0);
     // 2_0   to 4_0      TER+  to TGT1+ [START]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 2L<<32|0);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 4L<<32|0);
+    ASSERT_EQ(t.ter_arc.v_lv, 2L<<32|0);
+    ASSERT_EQ(t.ter_arc.w_lw, 4L<<32|0);
     // 4_e-b to 0_e      TGT1+ to SEG1+ [START]
-    ASSERT_EQ(g.arcs.at(1).v_lv, 4L<<32|(5-2));
-    ASSERT_EQ(g.arcs.at(1).w_lw, 0L<<32|5);
-    ASSERT_EQ(g.segs.at(2).data, "TTA");
+    ASSERT_EQ(t.ctg_arc.v_lv, 4L<<32|(5-2));
+    ASSERT_EQ(t.ctg_arc.w_lw, 0L<<32|5);
+    ASSERT_EQ(seq(t.tgt_seg), "TTA");
 }
 
 TEST(targets_test, start_pos_point) {
@@ -130,8 +137,8 @@ TEST(targets_test, start_pos_point) {
     ASSERT_EQ(a.v_lv, 2L<<32|0);
     ASSERT_EQ(a.w_lw, 0L<<32|7);
     // 2_0   to 4_0      TER+  to TGT1+ [START]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 2L<<32|0);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 0L<<32|7);
+    ASSERT_EQ(t.ter_arc.v_lv, 2L<<32|0);
+    ASSERT_EQ(t.ter_arc.w_lw, 0L<<32|7);
 }
 
 
@@ -143,12 +150,12 @@ TEST(targets_test, start_neg_full) {
     ASSERT_EQ(a.v_lv, 2L<<32|0);
     ASSERT_EQ(a.w_lw, 5L<<32|0);
     // 2_0   to 5_0/1_e     TER+  to TGT1- [START]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 2L<<32|0);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 5L<<32|0);
+    ASSERT_EQ(t.ter_arc.v_lv, 2L<<32|0);
+    ASSERT_EQ(t.ter_arc.w_lw, 5L<<32|0);
     // 5_e-b to 1_e      TGT1- to SEG1- [START]
-    ASSERT_EQ(g.arcs.at(1).v_lv, 5L<<32|10);
-    ASSERT_EQ(g.arcs.at(1).w_lw, 1L<<32|10);
-    ASSERT_EQ(g.segs.at(2).data, "CATTAGTACT");
+    ASSERT_EQ(t.ctg_arc.v_lv, 5L<<32|10);
+    ASSERT_EQ(t.ctg_arc.w_lw, 1L<<32|10);
+    ASSERT_EQ(seq(t.tgt_seg), "CATTAGTACT");
 }
 
 TEST(targets_test, start_neg_part) {
@@ -159,12 +166,15 @@ TEST(targets_test, start_neg_part) {
     ASSERT_EQ(a.v_lv, 2L<<32|0);
     ASSERT_EQ(a.w_lw, 5L<<32|0);
     // 2_0   to 5_0      TER+  to TGT1- [START]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 2L<<32|0);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 5L<<32|0);
+    ASSERT_EQ(t.ter_arc.v_lv, 2L<<32|0);
+    ASSERT_EQ(t.ter_arc.w_lw, 5L<<32|0);
     // 5_e-b to 1_e      TGT1- to SEG1- [START]
-    ASSERT_EQ(g.arcs.at(1).v_lv, 5L<<32|(5-2));
-    ASSERT_EQ(g.arcs.at(1).w_lw, 1L<<32|5);
-    ASSERT_EQ(g.segs.at(2).data, "TTA");
+    ASSERT_EQ(t.ctg_arc.v_lv, 5L<<32|(5-2));
+    ASSERT_EQ(t.ctg_arc.w_lw, 1L<<32|5);
+    ASSERT_EQ(seq(t.tgt_seg), "TTA");
+    ASSERT_EQ(seq(t.tgt_seg, true), "TAA");     // the view reverse complements
+    ASSERT_EQ(seq(t.tgt_seg, true, 1, 3), "AA");
+    ASSERT_EQ(t.tgt_seg.ref, &g.segs[0]);       // and copies no sequence
 }
 
 TEST(targets_test, start_neg_point) {
@@ -175,8 +185,8 @@ TEST(targets_test, start_neg_point) {
     ASSERT_EQ(a.v_lv, 2L<<32|0);
     ASSERT_EQ(a.w_lw, 1L<<32|7);
     // 2_0   to 5_0      TER+  to TGT1- [START]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 2L<<32|0);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 1L<<32|7);
+    ASSERT_EQ(t.ter_arc.v_lv, 2L<<32|0);
+    ASSERT_EQ(t.ter_arc.w_lw, 1L<<32|7);
 }
 
 
@@ -185,15 +195,15 @@ TEST(targets_test, end_pos_full) {
     target t(g);
     t.set("SEG1+", target::role_t::END);
     arc a = t.get_arc();
-    ASSERT_EQ(a.v_lv, 4L<<32|10);
+    ASSERT_EQ(a.v_lv, 6L<<32|10);
     ASSERT_EQ(a.w_lw, 2L<<32|1);
-    // 0_b   to 4_0/2_1   SEG1+ to TGT1+ [END]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 0L<<32|0);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 4L<<32|0);
-    // 4_e-b to 2_1      TGT1+ to TER+  [END]
-    ASSERT_EQ(g.arcs.at(1).v_lv, 4L<<32|10);
-    ASSERT_EQ(g.arcs.at(1).w_lw, 2L<<32|1);
-    ASSERT_EQ(g.segs.at(2).data, "CATTAGTACT");
+    // 0_b   to 6_0/2_1   SEG1+ to TGT2+ [END]
+    ASSERT_EQ(t.ctg_arc.v_lv, 0L<<32|0);
+    ASSERT_EQ(t.ctg_arc.w_lw, 6L<<32|0);
+    // 6_e-b to 2_1      TGT2+ to TER+  [END]
+    ASSERT_EQ(t.ter_arc.v_lv, 6L<<32|10);
+    ASSERT_EQ(t.ter_arc.w_lw, 2L<<32|1);
+    ASSERT_EQ(seq(t.tgt_seg), "CATTAGTACT");
 }
 
 TEST(targets_test, end_pos_part) {
@@ -201,15 +211,15 @@ TEST(targets_test, end_pos_part) {
     target t(g);
     t.set("SEG1:2:5+", target::role_t::END);
     arc a = t.get_arc();
-    ASSERT_EQ(a.v_lv, 4L<<32|(5-2));
+    ASSERT_EQ(a.v_lv, 6L<<32|(5-2));
     ASSERT_EQ(a.w_lw, 2L<<32|1);
-    // 0_b   to 4_0      SEG1+ to TGT1+ [END]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 0L<<32|2);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 4L<<32|0);
-    // 4_e-b to 2_1      TGT1+ to TER+  [END]
-    ASSERT_EQ(g.arcs.at(1).v_lv, 4L<<32|(5-2));
-    ASSERT_EQ(g.arcs.at(1).w_lw, 2L<<32|1);
-    ASSERT_EQ(g.segs.at(2).data, "TTA");
+    // 0_b   to 6_0      SEG1+ to TGT2+ [END]
+    ASSERT_EQ(t.ctg_arc.v_lv, 0L<<32|2);
+    ASSERT_EQ(t.ctg_arc.w_lw, 6L<<32|0);
+    // 6_e-b to 2_1      TGT2+ to TER+  [END]
+    ASSERT_EQ(t.ter_arc.v_lv, 6L<<32|(5-2));
+    ASSERT_EQ(t.ter_arc.w_lw, 2L<<32|1);
+    ASSERT_EQ(seq(t.tgt_seg), "TTA");
 }
 
 TEST(targets_test, end_pos_point) {
@@ -219,9 +229,9 @@ TEST(targets_test, end_pos_point) {
     arc a = t.get_arc();
     ASSERT_EQ(a.v_lv, 0L<<32|7);
     ASSERT_EQ(a.w_lw, 2L<<32|1);
-    // 0_b   to 4_0      SEG1+ to TGT1+ [END]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 0L<<32|7);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 2L<<32|1);
+    // 0_b   to 6_0      SEG1+ to TGT2+ [END]
+    ASSERT_EQ(t.ter_arc.v_lv, 0L<<32|7);
+    ASSERT_EQ(t.ter_arc.w_lw, 2L<<32|1);
 }
 
 
@@ -230,14 +240,14 @@ TEST(targets_test, end_neg_full) {
     target t(g);
     t.set("SEG1-", target::role_t::END);
     arc a = t.get_arc();
-    ASSERT_EQ(a.v_lv, 5L<<32|10);
+    ASSERT_EQ(a.v_lv, 7L<<32|10);
     ASSERT_EQ(a.w_lw, 2L<<32|1);
-    // 1_b to 5_0/2_1   SEG1- to TGT1-/TER+ [END]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 1L<<32|0);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 5L<<32|0);
-    // 5_e-b to 2_1      TGT1- to TER+  [END]
-    ASSERT_EQ(g.arcs.at(1).v_lv, 5L<<32|10);
-    ASSERT_EQ(g.arcs.at(1).w_lw, 2L<<32|1);
+    // 1_b to 7_0/2_1   SEG1- to TGT2-/TER+ [END]
+    ASSERT_EQ(t.ctg_arc.v_lv, 1L<<32|0);
+    ASSERT_EQ(t.ctg_arc.w_lw, 7L<<32|0);
+    // 7_e-b to 2_1      TGT2- to TER+  [END]
+    ASSERT_EQ(t.ter_arc.v_lv, 7L<<32|10);
+    ASSERT_EQ(t.ter_arc.w_lw, 2L<<32|1);
 }
 
 TEST(targets_test, end_neg_part) {
@@ -245,15 +255,15 @@ TEST(targets_test, end_neg_part) {
     target t(g);
     t.set("SEG1:2:5-", target::role_t::END);
     arc a = t.get_arc();
-    ASSERT_EQ(a.v_lv, 5L<<32|(5-2));
+    ASSERT_EQ(a.v_lv, 7L<<32|(5-2));
     ASSERT_EQ(a.w_lw, 2L<<32|1);
-    // 1_b   to 5_0      SEG1- to TGT1- [END]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 1L<<32|2);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 5L<<32|0);
-    // 5_e-b to 2_1      TGT1- to TER+  [END]
-    ASSERT_EQ(g.arcs.at(1).v_lv, 5L<<32|(5-2));
-    ASSERT_EQ(g.arcs.at(1).w_lw, 2L<<32|1);
-    ASSERT_EQ(g.segs.at(2).data, "TTA");
+    // 1_b   to 7_0      SEG1- to TGT2- [END]
+    ASSERT_EQ(t.ctg_arc.v_lv, 1L<<32|2);
+    ASSERT_EQ(t.ctg_arc.w_lw, 7L<<32|0);
+    // 7_e-b to 2_1      TGT2- to TER+  [END]
+    ASSERT_EQ(t.ter_arc.v_lv, 7L<<32|(5-2));
+    ASSERT_EQ(t.ter_arc.w_lw, 2L<<32|1);
+    ASSERT_EQ(seq(t.tgt_seg), "TTA");
 }
 
 TEST(targets_test, end_neg_point) {
@@ -263,9 +273,9 @@ TEST(targets_test, end_neg_point) {
     arc a = t.get_arc();
     ASSERT_EQ(a.v_lv, 1L<<32|7);
     ASSERT_EQ(a.w_lw, 2L<<32|1);
-    // 1_b   to 5_0      SEG1- to TGT1- [END]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 1L<<32|7);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 2L<<32|1);
+    // 1_b   to 7_0      SEG1- to TGT2- [END]
+    ASSERT_EQ(t.ter_arc.v_lv, 1L<<32|7);
+    ASSERT_EQ(t.ter_arc.w_lw, 2L<<32|1);
 }
 
 
@@ -278,24 +288,59 @@ TEST(targets_test, reinsert_test) {
     ASSERT_EQ(a.v_lv, 2L<<32|0);
     ASSERT_EQ(a.w_lw, 4L<<32|0);
     // 2_0   to 4_0      TER+  to TGT1+ [START]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 2L<<32|0);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 4L<<32|0);
+    ASSERT_EQ(t.ter_arc.v_lv, 2L<<32|0);
+    ASSERT_EQ(t.ter_arc.w_lw, 4L<<32|0);
     // 4_e-b to 0_e      TGT1+ to SEG1+ [START]
-    ASSERT_EQ(g.arcs.at(1).v_lv, 4L<<32|(6-2));
-    ASSERT_EQ(g.arcs.at(1).w_lw, 0L<<32|6);
-    ASSERT_EQ(g.segs.at(2).data, "TTAG");
+    ASSERT_EQ(t.ctg_arc.v_lv, 4L<<32|(6-2));
+    ASSERT_EQ(t.ctg_arc.w_lw, 0L<<32|6);
+    ASSERT_EQ(seq(t.tgt_seg), "TTAG");
 
     t.set("SEG1:2:6-", target::role_t::END);
     a = t.get_arc();
-    ASSERT_EQ(a.v_lv, 5L<<32|(6-2));
+    ASSERT_EQ(a.v_lv, 7L<<32|(6-2));
     ASSERT_EQ(a.w_lw, 2L<<32|1);
-    // 1_b   to 5_0      SEG1- to TGT1- [END]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 1L<<32|2);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 5L<<32|0);
-    // 5_e-b to 2_1      TGT1- to TER+  [END]
-    ASSERT_EQ(g.arcs.at(1).v_lv, 5L<<32|(6-2));
-    ASSERT_EQ(g.arcs.at(1).w_lw, 2L<<32|1);
-    ASSERT_EQ(g.segs.at(2).data, "TTAG");
+    // 1_b   to 7_0      SEG1- to TGT2- [END]
+    ASSERT_EQ(t.ctg_arc.v_lv, 1L<<32|2);
+    ASSERT_EQ(t.ctg_arc.w_lw, 7L<<32|0);
+    // 7_e-b to 2_1      TGT2- to TER+  [END]
+    ASSERT_EQ(t.ter_arc.v_lv, 7L<<32|(6-2));
+    ASSERT_EQ(t.ter_arc.w_lw, 2L<<32|1);
+    ASSERT_EQ(seq(t.tgt_seg), "TTAG");
+
+    ASSERT_EQ(g.segs.size(), 1);                // graph is left as is
+    ASSERT_EQ(g.arcs.size(), 0);
+}
+
+
+TEST(targets_test, try_set_invalid) {
+    graph g = make_graph();
+    target t(g);
+    std::string err;
+
+    t.set("SEG1:2:6+", target::role_t::START);
+
+    ASSERT_FALSE(t.try_set("SEG1:2", target::role_t::END, 0, err));
+    ASSERT_EQ(err, "invalid target syntax: SEG1:2");
+    ASSERT_FALSE(t.try_set("SEG2+", target::role_t::END, 0, err));
+    ASSERT_EQ(err, "contig not in graph: SEG2");
+    ASSERT_FALSE(t.try_set("SEG1:11+", target::role_t::END, 0, err));
+    ASSERT_EQ(err, "start pos 11 exceeds segment length 10 for target: SEG1");
+    ASSERT_FALSE(t.try_set("SEG1:6:2+", target::role_t::END, 0, err));
+    ASSERT_EQ(err, "begin position beyond end position on target: SEG1");
+    ASSERT_FALSE(t.try_set("SEG1:6:11+", target::role_t::END, 0, err));
+    ASSERT_EQ(err, "end pos 11 exceeds segment length 10 for target: SEG1");
+    ASSERT_FALSE(t.try_set("SEG1:99999999999999999999+", target::role_t::END, 0, err));
+    ASSERT_EQ(err, "invalid target syntax: SEG1:99999999999999999999+");
+
+    ASSERT_EQ(t.get_arc().v_lv, 2L<<32|0);      // the target is left as it was
+    ASSERT_EQ(seq(t.tgt_seg), "TTAG");
+
+    ASSERT_TRUE(t.try_set("SEG1:2:6-", target::role_t::END, 0, err));
+    ASSERT_EQ(t.get_arc().v_lv, 7L<<32|(6-2));
+
+    ASSERT_EXIT( t.set("SEG2+", target::role_t::START);,
+            testing::ExitedWithCode(1),
+            ": error: contig not in graph: SEG2");
 }
 
 
@@ -314,50 +359,69 @@ TEST(targets_test, two_pos_tgts) {
     ASSERT_EQ(a2.w_lw, 2L<<32|1);
 
     // 0_b   to 6_0      SEG1+ to TGT2+ [END]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 0L<<32|4);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 6L<<32|0);
+    ASSERT_EQ(t2.ctg_arc.v_lv, 0L<<32|4);
+    ASSERT_EQ(t2.ctg_arc.w_lw, 6L<<32|0);
     // 2_0   to 4_0      TER+  to TGT1+ [START]
-    ASSERT_EQ(g.arcs.at(1).v_lv, 2L<<32|0);
-    ASSERT_EQ(g.arcs.at(1).w_lw, 4L<<32|0);
+    ASSERT_EQ(t1.ter_arc.v_lv, 2L<<32|0);
+    ASSERT_EQ(t1.ter_arc.w_lw, 4L<<32|0);
     // 4_e-b to 0_e      TGT1+ to SEG1+ [START]
-    ASSERT_EQ(g.arcs.at(2).v_lv, 4L<<32|2);
-    ASSERT_EQ(g.arcs.at(2).w_lw, 0L<<32|3);
+    ASSERT_EQ(t1.ctg_arc.v_lv, 4L<<32|2);
+    ASSERT_EQ(t1.ctg_arc.w_lw, 0L<<32|3);
     // 6_e-b to 2_1      TGT2+ to TER+  [END]
-    ASSERT_EQ(g.arcs.at(3).v_lv, 6L<<32|4);
-    ASSERT_EQ(g.arcs.at(3).w_lw, 2L<<32|1);
+    ASSERT_EQ(t2.ter_arc.v_lv, 6L<<32|4);
+    ASSERT_EQ(t2.ter_arc.w_lw, 2L<<32|1);
+
+    // the overlay arcs are in path order
+    const arc* as[2];
+    ASSERT_EQ(t1.overlay_arcs(as), 2);
+    ASSERT_EQ(as[0], &t1.ter_arc);
+    ASSERT_EQ(as[1], &t1.ctg_arc);
+    ASSERT_EQ(t2.overlay_arcs(as), 2);
+    ASSERT_EQ(as[0], &t2.ctg_arc);
+    ASSERT_EQ(as[1], &t2.ter_arc);
+
+    // and each target resolves its own virtual segment
+    ASSERT_EQ(t1.find_seg(1)->name, "__T__");
+    ASSERT_EQ(seq(*t1.find_seg(2)), "AT");
+    ASSERT_EQ(t1.find_seg(3), nullptr);
+    ASSERT_EQ(seq(*t2.find_seg(3)), "AGTA");
 }
 
 
-// 0_b   to 6_0      SEG1+ to TGT1+ [END]
+// virtual arcs for two segs, START target on TGT1, END target on TGT2
+//
 // 0_b   to 8_0      SEG1+ to TGT2+ [END]
-// 1_L-e to 7_0      SEG1- to TGT1- [END]
 // 1_L-e to 9_0      SEG1- to TGT2- [END]
-// 2_b   to 6_0      SEG2+ to TGT1+ [END]
 // 2_b   to 8_0      SEG2+ to TGT2+ [END]
-// 3_L-e to 7_0      SEG2- to TGT1- [END]
 // 3_L-e to 9_0      SEG2- to TGT2- [END]
 // 4_0   to 6_0      TER+  to TGT1+ [START]
-// 4_0   to 8_0      TER+  to TGT2+ [START]
 // 4_0   to 7_0      TER+  to TGT1- [START]
-// 4_0   to 9_0      TER+  to TGT2- [START]
 // 6_e-b to 0_e      TGT1+ to SEG1+ [START]
 // 6_e-b to 2_e      TGT1+ to SEG2+ [START]
-// 6_e-b to 4_1      TGT1+ to TER+  [END]
 // 7_e-b to 1_L-b    TGT1- to SEG1- [START]
 // 7_e-b to 3_L-b    TGT1- to SEG2- [START]
-// 7_e-b to 4_1      TGT1- to TER+  [END]
-// 8_e-b to 0_e      TGT2+ to SEG1+ [START]
-// 8_e-b to 2_e      TGT2+ to SEG2+ [START]
 // 8_e-b to 4_1      TGT2+ to TER+  [END]
-// 9_e-b to 1_L-b    TGT2- to SEG1- [START]
-// 9_e-b to 3_L-b    TGT2- to SEG2- [START]
 // 9_e-b to 4_1      TGT2- to TER+  [END]
 
+TEST(targets_test, numbered_ends) {
+    graph g = make_graph();
+    target t0(g), t1(g);
+    t0.set("SEG1:2:5+", target::role_t::END, 0);
+    t1.set("SEG1:2:5+", target::role_t::END, 1);
+    ASSERT_EQ(t0.seg_ix(), 3);                  // after TER (1) and START (2)
+    ASSERT_EQ(t1.seg_ix(), 4);
+    ASSERT_EQ(t1.ctg_arc.w_lw, 8L<<32|0);       // to TGT+ of the next number
+    ASSERT_EQ(t1.ter_arc.v_lv, 8L<<32|(5-2));
+    ASSERT_EQ(t1.find_seg(4), &t1.tgt_seg);
+    ASSERT_FALSE(t1.find_seg(3));
+
+    t1.set("SEG1:2:5+", target::role_t::START, 1);
+    ASSERT_EQ(t1.seg_ix(), 2);                  // START targets are not numbered
+}
+
 TEST(targets_test, two_segs_two_tgts) {
 
     graph g;
-    g.segs.reserve(2 + 3 /* two targets and a terminator */);
-    g.arcs.reserve(2 * 4 /* four for each target */);
     g.add_seg({ 11, "SEG1", "GCTATGACAAT" });
     g.add_seg({ 9,  "SEG2", "TTGTATAGT" });
 
@@ -373,17 +437,17 @@ TEST(targets_test, two_segs_two_tgts) {
     ASSERT_EQ(a2.w_lw, 4L<<32|1);
 
     // 2_b   to 8_0      SEG2+ to TGT2+ [END]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 2L<<32|3);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 8L<<32|0);
+    ASSERT_EQ(t2.ctg_arc.v_lv, 2L<<32|3);
+    ASSERT_EQ(t2.ctg_arc.w_lw, 8L<<32|0);
     // 4_0   to 7_0      TER+  to TGT1- [START]
-    ASSERT_EQ(g.arcs.at(1).v_lv, 4L<<32|0);
-    ASSERT_EQ(g.arcs.at(1).w_lw, 7L<<32|0);
+    ASSERT_EQ(t1.ter_arc.v_lv, 4L<<32|0);
+    ASSERT_EQ(t1.ter_arc.w_lw, 7L<<32|0);
     // 7_e-b to 1_e      TGT1- to SEG1- [START]
-    ASSERT_EQ(g.arcs.at(2).v_lv, 7L<<32|(9-4));
-    ASSERT_EQ(g.arcs.at(2).w_lw, 1L<<32|9);
+    ASSERT_EQ(t1.ctg_arc.v_lv, 7L<<32|(9-4));
+    ASSERT_EQ(t1.ctg_arc.w_lw, 1L<<32|9);
     // 8_e-b to 4_1      TGT2+ to TER+  [END]
-    ASSERT_EQ(g.arcs.at(3).v_lv, 8L<<32|(8-3));
-    ASSERT_EQ(g.arcs.at(3).w_lw, 4L<<32|1);
+    ASSERT_EQ(t2.ter_arc.v_lv, 8L<<32|(8-3));
+    ASSERT_EQ(t2.ter_arc.w_lw, 4L<<32|1);
 
         // now flip them
 
@@ -391,24 +455,24 @@ TEST(targets_test, two_segs_two_tgts) {
     t2.set("SEG2:3:8+", target::role_t::START);
 
     a1 = t1.get_arc();
-    ASSERT_EQ(a1.v_lv, 7L<<32|(9-4));
+    ASSERT_EQ(a1.v_lv, 9L<<32|(9-4));
     ASSERT_EQ(a1.w_lw, 4L<<32|1);
     a2 = t2.get_arc();
     ASSERT_EQ(a2.v_lv, 4L<<32|0);
-    ASSERT_EQ(a2.w_lw, 8L<<32|0);
-
-    // 1_b   to 7_0      SEG1- to TGT1- [END]
-    ASSERT_EQ(g.arcs.at(0).v_lv, 1L<<32|4);
-    ASSERT_EQ(g.arcs.at(0).w_lw, 7L<<32|0);
-    // 4_0   to 8_0      TER+  to TGT2+ [START]
-    ASSERT_EQ(g.arcs.at(1).v_lv, 4L<<32|0);
-    ASSERT_EQ(g.arcs.at(1).w_lw, 8L<<32|0);
-    // 7_e-b to 4_1      TGT1- to TER+  [END]
-    ASSERT_EQ(g.arcs.at(2).v_lv, 7L<<32|(9-4));
-    ASSERT_EQ(g.arcs.at(2).w_lw, 4L<<32|1);
-    // 8_e-b to 2_e      TGT2+ to SEG2+ [START]
-    ASSERT_EQ(g.arcs.at(3).v_lv, 8L<<32|(8-3));
-    ASSERT_EQ(g.arcs.at(3).w_lw, 2L<<32|8);
+    ASSERT_EQ(a2.w_lw, 6L<<32|0);
+
+    // 1_b   to 9_0      SEG1- to TGT2- [END]
+    ASSERT_EQ(t1.ctg_arc.v_lv, 1L<<32|4);
+    ASSERT_EQ(t1.ctg_arc.w_lw, 9L<<32|0);
+    // 4_0   to 6_0      TER+  to TGT1+ [START]
+    ASSERT_EQ(t2.ter_arc.v_lv, 4L<<32|0);
+    ASSERT_EQ(t2.ter_arc.w_lw, 6L<<32|0);
+    // 9_e-b to 4_1      TGT2- to TER+  [END]
+    ASSERT_EQ(t1.ter_arc.v_lv, 9L<<32|(9-4));
+    ASSERT_EQ(t1.ter_arc.w_lw, 4L<<32|1);
+    // 6_e-b to 2_e      TGT1+ to SEG2+ [START]
+    ASSERT_EQ(t2.ctg_arc.v_lv, 6L<<32|(8-3));
+    ASSERT_EQ(t2.ctg_arc.w_lw, 2L<<32|8);
 }
 
 
@@ -23,12 +23,23 @@
 #include <cstdio>
 #include <cstdarg>
 #include <cstdlib>
+#include <mutex>
 
 namespace gene_paths {
 
 static bool verbose = false;
 static const char* progname = "";
 
+// serialises the lines that threads write to stderr, so none interleave
+static std::mutex emit_mutex;
+
+static void
+emit_line(const char *prefix, const char *buf)
+{
+    std::lock_guard<std::mutex> lock(emit_mutex);
+    std::cerr << progname << prefix << buf << std::endl;
+}
+
 void
 set_progname(const char *p)
 {
@@ -57,10 +68,23 @@ raise_error(const char *fmt, ...)
     vsnprintf(buf, sizeof(buf), fmt, ap);
     va_end(ap);
 
-    std::cerr << progname << ": error: " << buf << std::endl;
+    emit_line(": error: ", buf);
     std::exit(1);
 }
 
+void
+report_error(const char *fmt, ...)
+{
+    char buf[2048];
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    emit_line(": error: ", buf);
+}
+
 void
 verbose_emit(const char *fmt, ...)
 {
@@ -73,7 +97,7 @@ verbose_emit(const char *fmt, ...)
         vsnprintf(buf, sizeof(buf), fmt, ap);
         va_end(ap);
 
-        std::cerr << progname << ": " << buf << std::endl;
+        emit_line(": ", buf);
     }
 }
 
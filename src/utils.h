@@ -21,6 +21,7 @@
 namespace gene_paths {
 
 extern void raise_error(const char* t, ...);
+extern void report_error(const char* t, ...);
 
 extern void set_progname(const char *name);
 extern bool get_verbose();